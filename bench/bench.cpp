@@ -0,0 +1,299 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <tabluzzy/tabluzzy.hpp>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+
+// the sizes the synthetic tables are generated with
+static const vector<int64_t> ROW_COUNTS = {1 << 12, 1 << 16, 1 << 20};
+static const vector<int64_t> COLUMN_COUNTS = {4, 16};
+// the percentage of numerical columns, the rest are string columns
+static const vector<int64_t> NUMBER_PERCENTAGES = {0, 50, 100};
+
+// stream buffer that throws away everything written to it
+class NullBuffer : public streambuf {
+ protected:
+  int overflow(int c) override { return c; }
+  streamsize xsputn(const char*, streamsize n) override { return n; }
+};
+
+// generates the csv text of a synthetic table, half of the string columns
+// repeat a few values and the other half hold a distinct value per row
+static const string& makeCsv(size_t rows, size_t columns, size_t percent) {
+  // the text is generated once for every shape
+  static map<tuple<size_t, size_t, size_t>, string> cache;
+  string& csv = cache[{rows, columns, percent}];
+  if (!csv.empty()) return csv;
+
+  size_t numerical = columns * percent / 100;
+  ostringstream out;
+  out << columns << "\n" << rows << "\n";
+  for (size_t x = 0; x < columns; x++) out << (x ? "," : "") << "c" << x;
+  out << "\n";
+  for (size_t x = 0; x < columns; x++) {
+    out << (x ? "," : "") << (x < numerical ? "number" : "string");
+  }
+  out << "\n";
+  mt19937_64 random(42);
+  uniform_real_distribution<double> number(-1e6, 1e6);
+  for (size_t y = 0; y < rows; y++) {
+    for (size_t x = 0; x < columns; x++) {
+      if (x > 0) out << ",";
+      if (x < numerical) {
+        out << number(random);
+      } else if ((x - numerical) % 2 == 0) {
+        out << "category" << random() % 16;
+      } else {
+        out << "id" << random();
+      }
+    }
+    out << "\n";
+  }
+  csv = out.str();
+  return csv;
+}
+
+// writes the csv text of a synthetic table to a temporary file
+static string makeCsvFile(size_t rows, size_t columns, size_t percent) {
+  string path = "tabluzzy_bench_" + to_string(rows) + "_" +
+                to_string(columns) + "_" + to_string(percent) + ".csv";
+  ofstream(path, ios::binary) << makeCsv(rows, columns, percent);
+  return path;
+}
+
+// loads a synthetic table
+static Table makeTable(size_t rows, size_t columns, size_t percent) {
+  istringstream in(makeCsv(rows, columns, percent));
+  Table table;
+  table.from_csv(in);
+  return table;
+}
+
+// gets the shape of the synthetic table of a benchmark
+static tuple<size_t, size_t, size_t> shapeOf(const benchmark::State& state) {
+  return {state.range(0), state.range(1), state.range(2)};
+}
+
+// counts the rows and bytes handled by a benchmark as its throughput
+static void setThroughput(benchmark::State& state, size_t rows,
+                          size_t bytes) {
+  state.SetItemsProcessed(state.iterations() * rows);
+  if (bytes > 0) state.SetBytesProcessed(state.iterations() * bytes);
+}
+
+static void BM_FromCsvStream(benchmark::State& state) {
+  auto [rows, columns, percent] = shapeOf(state);
+  const string& csv = makeCsv(rows, columns, percent);
+  for (auto _ : state) {
+    istringstream in(csv);
+    Table table;
+    table.from_csv(in);
+    benchmark::DoNotOptimize(table.getNumberOfRows());
+  }
+  setThroughput(state, rows, csv.size());
+}
+
+static void BM_FromCsvFile(benchmark::State& state) {
+  auto [rows, columns, percent] = shapeOf(state);
+  string path = makeCsvFile(rows, columns, percent);
+  for (auto _ : state) {
+    Table table;
+    table.from_csv(path);
+    benchmark::DoNotOptimize(table.getNumberOfRows());
+  }
+  setThroughput(state, rows, makeCsv(rows, columns, percent).size());
+  remove(path.c_str());
+}
+
+static void BM_FromCsvParallel(benchmark::State& state) {
+  auto [rows, columns, percent] = shapeOf(state);
+  string path = makeCsvFile(rows, columns, percent);
+  for (auto _ : state) {
+    Table table;
+    table.from_csv_parallel(path);
+    benchmark::DoNotOptimize(table.getNumberOfRows());
+  }
+  setThroughput(state, rows, makeCsv(rows, columns, percent).size());
+  remove(path.c_str());
+}
+
+static void BM_ToCsv(benchmark::State& state) {
+  auto [rows, columns, percent] = shapeOf(state);
+  Table table = makeTable(rows, columns, percent);
+  for (auto _ : state) {
+    vector<string> lines = table.to_csv();
+    benchmark::DoNotOptimize(lines.data());
+  }
+  setThroughput(state, rows, makeCsv(rows, columns, percent).size());
+}
+
+static void BM_ToCsvStream(benchmark::State& state) {
+  auto [rows, columns, percent] = shapeOf(state);
+  Table table = makeTable(rows, columns, percent);
+  NullBuffer buffer;
+  ostream out(&buffer);
+  for (auto _ : state) table.to_csv(out);
+  setThroughput(state, rows, makeCsv(rows, columns, percent).size());
+}
+
+static void BM_ToHtml(benchmark::State& state) {
+  auto [rows, columns, percent] = shapeOf(state);
+  Table table = makeTable(rows, columns, percent);
+  NullBuffer buffer;
+  ostream out(&buffer);
+  for (auto _ : state) table.to_html(out);
+  setThroughput(state, rows, 0);
+}
+
+static void BM_DisplayTable(benchmark::State& state) {
+  auto [rows, columns, percent] = shapeOf(state);
+  Table table = makeTable(rows, columns, percent);
+  // the table is drawn to a stream that discards it
+  NullBuffer buffer;
+  streambuf* console = cout.rdbuf(&buffer);
+  for (auto _ : state) table.displayTable();
+  cout.rdbuf(console);
+  setThroughput(state, rows, 0);
+}
+
+static void BM_SortTableByColumn(benchmark::State& state) {
+  auto [rows, columns, percent] = shapeOf(state);
+  Table original = makeTable(rows, columns, percent);
+  for (auto _ : state) {
+    // every iteration sorts the unsorted table
+    state.PauseTiming();
+    Table table = original;
+    state.ResumeTiming();
+    table.sortTableByColumn("c0");
+    benchmark::ClobberMemory();
+  }
+  setThroughput(state, rows, 0);
+}
+
+static void BM_InsertAndDeleteRow(benchmark::State& state) {
+  auto [rows, columns, percent] = shapeOf(state);
+  Table table = makeTable(rows, columns, percent);
+  vector<string> row = table.getAllValuesInRow(0);
+  for (auto _ : state) {
+    // a row is inserted in the middle of the table and deleted again
+    table.insertRowAtIndex(row, rows / 2);
+    table.deleteRow(rows / 2);
+  }
+  setThroughput(state, 2, 0);
+}
+
+static void BM_GetColumnByHeader(benchmark::State& state) {
+  auto [rows, columns, percent] = shapeOf(state);
+  Table table = makeTable(rows, columns, percent);
+  vector<string> headers = table.getAllColumnHeaders();
+  size_t i = 0;
+  for (auto _ : state) {
+    Column& col = table.getColumnByHeader(headers[i++ % headers.size()]);
+    benchmark::DoNotOptimize(&col);
+  }
+  setThroughput(state, 1, 0);
+}
+
+// benchmarks a statistic of the first column of a numerical table, the
+// cached statistics are invalidated before every iteration
+template <typename Statistic>
+static void BM_ColumnStatistic(benchmark::State& state, Statistic statistic) {
+  size_t rows = state.range(0);
+  Table table = makeTable(rows, 1, 100);
+  Column& col = table.getColumnByHeader("c0");
+  for (auto _ : state) {
+    col.setNumberAt(0, col.getNumberAt(0));
+    benchmark::DoNotOptimize(statistic(col));
+  }
+  setThroughput(state, rows, rows * sizeof(double));
+}
+
+// benchmarks a statistic over every column of a numerical table
+template <typename Statistic>
+static void BM_TableStatistic(benchmark::State& state, Statistic statistic) {
+  size_t rows = state.range(0), columns = 4;
+  Table table = makeTable(rows, columns, 100);
+  for (auto _ : state) {
+    for (size_t x = 0; x < columns; x++) {
+      Column& col = table[x];
+      col.setNumberAt(0, col.getNumberAt(0));
+    }
+    benchmark::DoNotOptimize(statistic(table));
+  }
+  setThroughput(state, rows * columns, rows * columns * sizeof(double));
+}
+
+// registers a benchmark for every synthetic table shape
+static void registerShapes(benchmark::internal::Benchmark* bench) {
+  bench->ArgsProduct({ROW_COUNTS, COLUMN_COUNTS, NUMBER_PERCENTAGES})
+      ->ArgNames({"rows", "columns", "numbers"})
+      ->Unit(benchmark::kMillisecond);
+}
+
+BENCHMARK(BM_FromCsvStream)->Apply(registerShapes);
+BENCHMARK(BM_FromCsvFile)->Apply(registerShapes);
+BENCHMARK(BM_FromCsvParallel)->Apply(registerShapes);
+BENCHMARK(BM_ToCsv)->Apply(registerShapes);
+BENCHMARK(BM_ToCsvStream)->Apply(registerShapes);
+BENCHMARK(BM_ToHtml)->Apply(registerShapes);
+BENCHMARK(BM_DisplayTable)->Apply(registerShapes);
+BENCHMARK(BM_SortTableByColumn)->Apply(registerShapes);
+BENCHMARK(BM_InsertAndDeleteRow)->Apply(registerShapes);
+BENCHMARK(BM_GetColumnByHeader)->Apply(registerShapes);
+
+// every statistic of a column and of a table
+#define COLUMN_STATISTIC(name)                                          \
+  BENCHMARK_CAPTURE(BM_ColumnStatistic, name,                           \
+                    [](const Column& col) { return col.name(); })       \
+      ->ArgsProduct({ROW_COUNTS})                                       \
+      ->ArgNames({"rows"})
+#define TABLE_STATISTIC(name)                                           \
+  BENCHMARK_CAPTURE(BM_TableStatistic, name,                            \
+                    [](Table& table) { return table.name(); })          \
+      ->ArgsProduct({ROW_COUNTS})                                       \
+      ->ArgNames({"rows"})
+
+COLUMN_STATISTIC(getMinimumValue);
+COLUMN_STATISTIC(getMaximumValue);
+COLUMN_STATISTIC(getMedian);
+COLUMN_STATISTIC(getMean);
+COLUMN_STATISTIC(getVariance);
+COLUMN_STATISTIC(getStdDeviation);
+COLUMN_STATISTIC(getRegression);
+TABLE_STATISTIC(getMinimumValue);
+TABLE_STATISTIC(getMaxiumValue);
+TABLE_STATISTIC(getMedian);
+TABLE_STATISTIC(getMean);
+TABLE_STATISTIC(getVariance);
+TABLE_STATISTIC(getStdDeviation);
+
+// the results are also written as json to tabluzzy_bench.json unless another
+// output was asked for, so they can be tracked over time
+int main(int argc, char** argv) {
+  vector<char*> args(argv, argv + argc);
+  bool hasOutput = false;
+  for (int i = 1; i < argc; i++) {
+    hasOutput |= string(argv[i]).rfind("--benchmark_out=", 0) == 0;
+  }
+  string out = "--benchmark_out=tabluzzy_bench.json";
+  string format = "--benchmark_out_format=json";
+  if (!hasOutput) {
+    args.push_back(out.data());
+    args.push_back(format.data());
+  }
+  int count = args.size();
+  benchmark::Initialize(&count, args.data());
+  if (benchmark::ReportUnrecognizedArguments(count, args.data())) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
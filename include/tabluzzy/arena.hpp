@@ -0,0 +1,157 @@
+#ifndef TABLUZZY_ARENA_HPP
+#define TABLUZZY_ARENA_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "metrics.hpp"
+#include "sharing.hpp"
+using namespace std;
+
+/// @brief the location of a string stored in a StringArena
+struct StrRef {
+  // the block holding the bytes of the string
+  uint32_t block = 0;
+  // the position of the first byte in the block
+  uint32_t offset = 0;
+  // the number of bytes of the string
+  uint32_t length = 0;
+};
+
+/// @brief stores the bytes of many strings in a few large blocks, so storing
+/// a string rarely allocates and the strings stored one after another are
+/// read from consecutive memory, blocks can also be borrowed from memory held
+/// outside of the arena. Stored bytes never change, so copies of the arena
+/// share its blocks and only store new strings in blocks of their own
+class StringArena {
+ public:
+  // the size of a block, strings that are bigger get a block of their own
+  static constexpr size_t BLOCK_SIZE = 1 << 20;
+
+  /// @brief copies the bytes of value into the arena
+  /// @param value the string to store
+  /// @return the location of the stored string
+  StrRef store(string_view value) {
+    StrRef ref;
+    ref.length = value.size();
+    // empty strings need no bytes
+    if (value.empty()) return ref;
+    // a string that does not fit in the last block starts a new one, the
+    // blocks never grow past their capacity so their bytes never move, and
+    // a last block shared with copies of the arena is left to them
+    if (blocks.empty() || blocks.back()->borrowed ||
+        !isOnlyOwner(blocks.back()) ||
+        blocks.back()->bytes.capacity() - blocks.back()->bytes.size() <
+            value.size()) {
+      blocks.push_back(make_shared<Block>());
+      blocks.back()->bytes.reserve(max(BLOCK_SIZE, value.size()));
+      TABLUZZY_COUNT(bytesAllocated, max(BLOCK_SIZE, value.size()));
+    }
+    vector<char>& last = blocks.back()->bytes;
+    ref.block = blocks.size() - 1;
+    ref.offset = last.size();
+    last.insert(last.end(), value.begin(), value.end());
+    storedBytes += value.size();
+    return ref;
+  }
+
+  /// @brief gets a view of a stored string
+  /// @param ref the location of the string
+  /// @return a view of the string, valid until the arena is cleared
+  string_view view(StrRef ref) const {
+    if (ref.length == 0) return {};
+    return string_view(blocks[ref.block]->data() + ref.offset, ref.length);
+  }
+
+  /// @brief adds a block of bytes held outside of the arena without copying
+  /// them, strings can then be referenced at offsets into the block
+  /// @param bytes the bytes of the block
+  /// @param owner keeps the memory of the bytes alive as long as the arena
+  /// borrows from it
+  /// @return the index of the block
+  uint32_t addBorrowedBlock(string_view bytes, shared_ptr<const void> owner) {
+    blocks.push_back(make_shared<Block>());
+    blocks.back()->borrowed = bytes.data();
+    owners.push_back(move(owner));
+    return blocks.size() - 1;
+  }
+
+  /// @brief moves every block of other to the end of this arena without
+  /// copying any bytes, leaving other empty
+  /// @param other the arena to take the blocks of
+  /// @return the number the block of a location in other has to be moved by
+  /// to locate the same string in this arena
+  uint32_t splice(StringArena& other) {
+    uint32_t shift = blocks.size();
+    blocks.insert(blocks.end(), make_move_iterator(other.blocks.begin()),
+                  make_move_iterator(other.blocks.end()));
+    owners.insert(owners.end(), make_move_iterator(other.owners.begin()),
+                  make_move_iterator(other.owners.end()));
+    storedBytes += other.storedBytes;
+    deadBytes += other.deadBytes;
+    other.clear();
+    return shift;
+  }
+
+  /// @brief marks a stored string as no longer referenced, its bytes stay in
+  /// the arena until it is repacked, borrowed bytes are not counted
+  /// @param ref the location of the string
+  void release(StrRef ref) {
+    if (ref.length != 0 && !blocks[ref.block]->borrowed) {
+      deadBytes += ref.length;
+    }
+  }
+
+  /// @brief gets the number of bytes stored so far, including the bytes of
+  /// strings that are not referenced anymore
+  /// @return the number of bytes stored
+  size_t getStoredBytes() const { return storedBytes; }
+
+  /// @brief gets the number of stored bytes of strings that were released
+  /// @return the number of bytes no longer referenced
+  size_t getDeadBytes() const { return deadBytes; }
+
+  /// @brief frees every block of the arena at once
+  void clear() {
+    blocks.clear();
+    owners.clear();
+    storedBytes = deadBytes = 0;
+  }
+
+  /// @brief swaps the blocks of two arenas
+  /// @param other the arena to swap with
+  void swap(StringArena& other) {
+    blocks.swap(other.blocks);
+    owners.swap(other.owners);
+    std::swap(storedBytes, other.storedBytes);
+    std::swap(deadBytes, other.deadBytes);
+  }
+
+ private:
+  // a block of bytes, either owned by the block or borrowed
+  struct Block {
+    // the bytes owned by the block
+    vector<char> bytes;
+    // the bytes borrowed by the block, nullptr if it owns its bytes
+    const char* borrowed = nullptr;
+
+    const char* data() const { return borrowed ? borrowed : bytes.data(); }
+  };
+
+  // the blocks holding the bytes of the strings, shared with the copies of
+  // the arena
+  vector<shared_ptr<Block>> blocks;
+  // keep alive the memory borrowed blocks point into
+  vector<shared_ptr<const void>> owners;
+  // the number of bytes stored in the blocks
+  size_t storedBytes = 0;
+  // the number of stored bytes of released strings
+  size_t deadBytes = 0;
+};
+
+#endif
@@ -0,0 +1,314 @@
+#ifndef TABLUZZY_CHUNKS_HPP
+#define TABLUZZY_CHUNKS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "metrics.hpp"
+#include "sharing.hpp"
+using namespace std;
+
+/// @brief Class for a sequence of values stored in chunks of rows, values are
+/// inserted and deleted inside a single chunk so edits in the middle of a
+/// long column only move the values of one chunk, while every chunk stays
+/// contiguous for fast scans. Chunks can also borrow values from memory held
+/// outside of the vector, such as a memory mapped file, and are only copied
+/// once they are modified. Copies of the vector share their chunks, so a
+/// copy takes constant time and only the chunks a copy modifies are copied
+template <typename T>
+class ChunkedVector {
+ public:
+  // the number of values a chunk is filled with before a new one is started
+  static constexpr size_t CHUNK_SIZE = 4096;
+
+  ChunkedVector() = default;
+  // copies share the chunks of the vector, and a vector that is moved from
+  // keeps sharing them too, so it never loses its layout
+  ChunkedVector(const ChunkedVector&) = default;
+  ChunkedVector& operator=(const ChunkedVector&) = default;
+
+  /// @brief gets the number of values
+  /// @return the number of values
+  size_t size() const { return count; }
+
+  /// @brief checks if there are no values
+  /// @return true if there are no values
+  bool empty() const { return count == 0; }
+
+  /// @brief subscript operator used to read the value at index i
+  /// @param i the index of the value
+  /// @return a read only reference to the value
+  const T& operator[](size_t i) const {
+    auto [c, offset] = locate(i);
+    return layout->chunks[c].data()[offset];
+  }
+
+  /// @brief subscript operator used to modify the value at index i
+  /// @param i the index of the value
+  /// @return a reference to the value
+  T& operator[](size_t i) {
+    auto [c, offset] = locate(i);
+    return own(c)[offset];
+  }
+
+  /// @brief adds a value after the last value
+  /// @param value the value to add
+  template <typename U>
+  void push_back(U&& value) {
+    Layout& edited = edit();
+    vector<Chunk>& chunks = edited.chunks;
+    // a full last chunk is followed by a new one
+    if (chunks.empty() || chunks.back().size() >= CHUNK_SIZE) {
+      // a chunk that was split can hold more than the chunk size
+      if (!chunks.empty() && chunks.back().size() != CHUNK_SIZE) {
+        uniform = false;
+      }
+      addChunk(edited);
+    }
+    own(chunks.size() - 1).push_back(forward<U>(value));
+    count++;
+  }
+
+  /// @brief copies values after the last value, a chunk at a time
+  /// @param values the values to append
+  void append(span<const T> values) {
+    Layout& edited = edit();
+    vector<Chunk>& chunks = edited.chunks;
+    while (!values.empty()) {
+      // a full last chunk is followed by a new one, as in push_back
+      if (chunks.empty() || chunks.back().size() >= CHUNK_SIZE) {
+        if (!chunks.empty() && chunks.back().size() != CHUNK_SIZE) {
+          uniform = false;
+        }
+        addChunk(edited);
+      }
+      // the last chunk is filled up to the chunk size in one copy
+      vector<T>& last = own(chunks.size() - 1);
+      size_t n = min(values.size(), CHUNK_SIZE - last.size());
+      last.insert(last.end(), values.begin(), values.begin() + n);
+      count += n;
+      values = values.subspan(n);
+    }
+  }
+
+  /// @brief appends values held by memory outside of the vector without
+  /// copying them, a chunk of them is only copied once it is modified
+  /// @param values the values to append
+  /// @param owner keeps the memory of the values alive as long as the vector
+  /// borrows from it
+  void appendBorrowed(span<const T> values, shared_ptr<const void> owner) {
+    if (values.empty()) return;
+    Layout& edited = edit();
+    vector<Chunk>& chunks = edited.chunks;
+    // a last chunk that is not full leaves a gap before the borrowed chunks
+    if (!chunks.empty() && chunks.back().size() != CHUNK_SIZE) {
+      uniform = false;
+    }
+    // the values are split into chunks of the usual size
+    for (size_t first = 0; first < values.size(); first += CHUNK_SIZE) {
+      Chunk& chunk = chunks.emplace_back();
+      chunk.borrowed = values.data() + first;
+      chunk.borrowedSize = min(CHUNK_SIZE, values.size() - first);
+      edited.starts.push_back(count);
+      count += chunk.borrowedSize;
+    }
+    edited.owners.push_back(move(owner));
+  }
+
+  /// @brief inserts a value at index i, moving only the values after it in
+  /// the same chunk
+  /// @param i the index to insert at
+  /// @param value the value to insert
+  template <typename U>
+  void insert(size_t i, U&& value) {
+    if (i == count) return push_back(forward<U>(value));
+    auto [c, offset] = locate(i);
+    vector<T>& chunk = own(c);
+    vector<size_t>& starts = layout->starts;
+    chunk.insert(chunk.begin() + offset, forward<U>(value));
+    shiftStarts(c + 1, 1);
+    count++;
+    uniform = false;
+    // a chunk that grew to twice the chunk size is split in half
+    if (chunk.size() >= 2 * CHUNK_SIZE) {
+      size_t half = chunk.size() / 2;
+      vector<T> upper(make_move_iterator(chunk.begin() + half),
+                      make_move_iterator(chunk.end()));
+      chunk.erase(chunk.begin() + half, chunk.end());
+      layout->chunks.insert(layout->chunks.begin() + c + 1,
+                            Chunk{make_shared<vector<T>>(move(upper))});
+      starts.insert(starts.begin() + c + 1, starts[c] + half);
+    }
+  }
+
+  /// @brief deletes the value at index i, moving only the values after it in
+  /// the same chunk
+  /// @param i the index of the value to delete
+  void erase(size_t i) {
+    auto [c, offset] = locate(i);
+    vector<T>& chunk = own(c);
+    vector<Chunk>& chunks = layout->chunks;
+    vector<size_t>& starts = layout->starts;
+    chunk.erase(chunk.begin() + offset);
+    shiftStarts(c + 1, -1);
+    count--;
+    // only deleting the very last value keeps every chunk full
+    if (c + 1 != chunks.size() || offset != chunk.size()) uniform = false;
+    if (chunk.empty()) {
+      // empty chunks are dropped
+      chunks.erase(chunks.begin() + c);
+      starts.erase(starts.begin() + c);
+    } else if (c + 1 < chunks.size() &&
+               chunk.size() + chunks[c + 1].size() <= CHUNK_SIZE) {
+      // and a small chunk is merged with the next one if they fit together
+      vector<T>& next = own(c + 1);
+      chunk.insert(chunk.end(), make_move_iterator(next.begin()),
+                   make_move_iterator(next.end()));
+      chunks.erase(chunks.begin() + c + 1);
+      starts.erase(starts.begin() + c + 1);
+    }
+  }
+
+  /// @brief deletes every value
+  void clear() {
+    // the chunks may still be shared, so they are let go of instead
+    layout = make_shared<Layout>();
+    count = 0;
+    uniform = true;
+  }
+
+  /// @brief reserves room for the chunks needed by count values
+  /// @param n the number of values
+  void reserve(size_t n) {
+    Layout& edited = edit();
+    edited.chunks.reserve(n / CHUNK_SIZE + 1);
+    edited.starts.reserve(n / CHUNK_SIZE + 1);
+  }
+
+  /// @brief gets the number of chunks
+  /// @return the number of chunks
+  size_t getChunkCount() const { return layout->chunks.size(); }
+
+  /// @brief gets the values of chunk c as a contiguous read only block
+  /// @param c the index of the chunk
+  /// @return the values of the chunk
+  span<const T> getChunk(size_t c) const {
+    const Chunk& chunk = layout->chunks[c];
+    return span<const T>(chunk.data(), chunk.size());
+  }
+
+  /// @brief gets the index of the first value of chunk c
+  /// @param c the index of the chunk
+  /// @return the index of the first value of the chunk
+  size_t getChunkStart(size_t c) const { return layout->starts[c]; }
+
+  /// @brief gets what keeps the values of chunk c alive, the values stay
+  /// unchanged while it is held, as the vector copies a chunk held elsewhere
+  /// before it modifies it
+  /// @param c the index of the chunk
+  /// @return the owner of the values of the chunk
+  shared_ptr<const void> getChunkOwner(size_t c) const {
+    const Chunk& chunk = layout->chunks[c];
+    // borrowed values are kept alive by the owners of the layout
+    if (chunk.borrowed) return layout;
+    return chunk.values;
+  }
+
+  /// @brief calls visit with every chunk as a contiguous read only block, in
+  /// order
+  /// @param visit callable taking a span<const T>
+  template <typename Visitor>
+  void forEachChunk(Visitor&& visit) const {
+    for (const Chunk& chunk : layout->chunks) {
+      visit(span<const T>(chunk.data(), chunk.size()));
+    }
+  }
+
+ private:
+  // a chunk of values, either owned by the copies of the vector sharing the
+  // chunk or borrowed
+  struct Chunk {
+    // the values owned by the chunk
+    shared_ptr<vector<T>> values;
+    // the values borrowed by the chunk, nullptr if it owns its values
+    const T* borrowed = nullptr;
+    // the number of values borrowed by the chunk
+    size_t borrowedSize = 0;
+
+    size_t size() const { return borrowed ? borrowedSize : values->size(); }
+    const T* data() const { return borrowed ? borrowed : values->data(); }
+  };
+
+  // the chunks of the vector and where they start, shared by the copies of
+  // the vector until one of them changes
+  struct Layout {
+    // the chunks of values
+    vector<Chunk> chunks;
+    // keep alive the memory borrowed chunks point into
+    vector<shared_ptr<const void>> owners;
+    // the index of the first value of every chunk
+    vector<size_t> starts;
+  };
+
+  // the layout of the vector, never null
+  shared_ptr<Layout> layout = make_shared<Layout>();
+  // the total number of values
+  size_t count = 0;
+  // true while every chunk but the last one holds exactly CHUNK_SIZE values,
+  // which lets an index be located without a search
+  bool uniform = true;
+
+  // finds the chunk that holds index i and the offset of i in that chunk
+  pair<size_t, size_t> locate(size_t i) const {
+    if (uniform) return {i / CHUNK_SIZE, i % CHUNK_SIZE};
+    const vector<size_t>& starts = layout->starts;
+    size_t c = upper_bound(starts.begin(), starts.end(), i) - starts.begin();
+    return {c - 1, i - starts[c - 1]};
+  }
+
+  // copies the layout if it is shared with other vectors before it is
+  // changed, and returns it
+  Layout& edit() {
+    if (!isOnlyOwner(layout)) layout = make_shared<Layout>(*layout);
+    return *layout;
+  }
+
+  // adds an empty chunk after the last chunk
+  void addChunk(Layout& edited) {
+    edited.starts.push_back(count);
+    edited.chunks.emplace_back().values = make_shared<vector<T>>();
+    edited.chunks.back().values->reserve(CHUNK_SIZE);
+    TABLUZZY_COUNT(bytesAllocated, CHUNK_SIZE * sizeof(T));
+  }
+
+  // copies the values of chunk c before they are modified if they are
+  // borrowed or shared with other vectors, and returns the values of the
+  // chunk
+  vector<T>& own(size_t c) {
+    Chunk& chunk = edit().chunks[c];
+    if (chunk.borrowed || !isOnlyOwner(chunk.values)) {
+      const T* first = chunk.data();
+      size_t size = chunk.size();
+      auto values = make_shared<vector<T>>();
+      values->reserve(max(CHUNK_SIZE, size));
+      TABLUZZY_COUNT(bytesAllocated, values->capacity() * sizeof(T));
+      values->assign(first, first + size);
+      chunk.values = move(values);
+      chunk.borrowed = nullptr;
+      chunk.borrowedSize = 0;
+    }
+    return *chunk.values;
+  }
+
+  // moves the first index of every chunk from chunk c onwards by delta
+  void shiftStarts(size_t c, ptrdiff_t delta) {
+    vector<size_t>& starts = layout->starts;
+    for (; c < starts.size(); c++) starts[c] += delta;
+  }
+};
+
+#endif
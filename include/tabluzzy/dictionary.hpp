@@ -0,0 +1,118 @@
+#ifndef TABLUZZY_DICTIONARY_HPP
+#define TABLUZZY_DICTIONARY_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+/// @brief the distinct values of a dictionary encoded string column, every
+/// value is stored once and stands for the integer code it was given
+class Dictionary {
+ public:
+  Dictionary() = default;
+  // the lookup table points into the values, so a dictionary is never copied
+  Dictionary(const Dictionary&) = delete;
+  Dictionary& operator=(const Dictionary&) = delete;
+
+  /// @brief gets the code of value, adding value to the dictionary if it is
+  /// not in it yet
+  /// @param value the value to encode
+  /// @return the code of the value
+  uint32_t encode(string_view value) {
+    auto found = codes.find(value);
+    if (found != codes.end()) return found->second;
+    // the deque never moves its strings, so the key can view the stored value
+    uint32_t code = values.size();
+    const string& stored = values.emplace_back(value);
+    codes.emplace(stored, code);
+    return code;
+  }
+
+  /// @brief copies the dictionary, every value keeps its code
+  /// @return the copy
+  shared_ptr<Dictionary> copy() const {
+    auto copied = make_shared<Dictionary>();
+    for (const string& value : values) copied->encode(value);
+    lock_guard<mutex> lock(rankMutex);
+    copied->ranks = ranks;
+    copied->rankedCount.store(rankedCount.load(memory_order_relaxed),
+                              memory_order_relaxed);
+    return copied;
+  }
+
+  /// @brief finds the code of value without adding it
+  /// @param value the value to search for
+  /// @return the code of the value, -1 if the value is not in the dictionary
+  long long find(string_view value) const {
+    auto found = codes.find(value);
+    return (found == codes.end()) ? -1 : (long long)found->second;
+  }
+
+  /// @brief gets the value a code stands for
+  /// @param code the code to decode
+  /// @return a view of the value
+  string_view decode(uint32_t code) const { return values[code]; }
+
+  /// @brief gets the number of distinct values in the dictionary
+  /// @return the number of values
+  size_t size() const { return values.size(); }
+
+  /// @brief ranks every code by the lexicographic order of its value, so
+  /// rows can be compared by comparing the ranks of their codes, copies of a
+  /// column share their dictionary so the ranks are computed by one thread at
+  /// a time
+  /// @return the rank of every code
+  const vector<uint32_t>& getRanks() {
+    lock_guard<mutex> lock(rankMutex);
+    // the ranks only have to be recomputed after values were added
+    if (rankedCount.load(memory_order_relaxed) == values.size()) return ranks;
+    vector<uint32_t> order(values.size());
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(),
+         [this](uint32_t a, uint32_t b) { return values[a] < values[b]; });
+    ranks.resize(values.size());
+    for (size_t r = 0; r < order.size(); r++) ranks[order[r]] = r;
+    // the ranks are published once they are complete
+    rankedCount.store(values.size(), memory_order_release);
+    return ranks;
+  }
+
+  /// @brief checks if the ranks cover every value of the dictionary, without
+  /// taking the lock, values are only added to a dictionary no other column
+  /// shares so ranks that are up to date are never changed while they are
+  /// read
+  /// @return true if the ranks are up to date, false if they arent
+  bool hasRanks() const {
+    return rankedCount.load(memory_order_acquire) == values.size();
+  }
+
+  /// @brief gets the ranks computed by the last call to getRanks, only valid
+  /// after hasRanks returned true
+  /// @return the rank of every code
+  const vector<uint32_t>& getCachedRanks() const { return ranks; }
+
+ private:
+  // every distinct value, the code of a value is its position
+  deque<string> values;
+  // maps every value to its code
+  unordered_map<string_view, uint32_t> codes;
+  // the lexicographic rank of every code
+  vector<uint32_t> ranks;
+  // the number of values the ranks were computed for, stored after the ranks
+  // so the threads that load it can read them
+  atomic<size_t> rankedCount{0};
+  // guards the computation of the ranks
+  mutable mutex rankMutex;
+};
+
+#endif
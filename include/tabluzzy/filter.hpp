@@ -0,0 +1,150 @@
+#ifndef TABLUZZY_FILTER_HPP
+#define TABLUZZY_FILTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace std;
+
+class Column;
+class Table;
+
+// Enum to represent the comparison a predicate makes
+enum CompareOp {
+  equalTo = 0,
+  notEqualTo = 1,
+  lessThan = 2,
+  lessOrEqual = 3,
+  greaterThan = 4,
+  greaterOrEqual = 5
+};
+
+/// @brief Class for a set of rows of a table stored as a bitmap, one bit per
+/// row, so sets of rows combine a word of 64 rows at a time
+class Selection {
+ public:
+  /// @brief constructor method for a selection of rowCount rows
+  /// @param rowCount the number of rows the selection covers
+  /// @param selected whether every row starts selected
+  Selection(size_t rowCount = 0, bool selected = false);
+
+  /// @brief gets the number of rows the selection covers
+  /// @return the number of rows
+  size_t size() const { return rowCount; }
+
+  /// @brief checks if a row is selected
+  /// @param row the index of the row
+  /// @return true if the row is selected
+  bool test(size_t row) const { return (words[row / 64] >> (row % 64)) & 1; }
+
+  /// @brief selects a row
+  /// @param row the index of the row
+  void set(size_t row) { words[row / 64] |= uint64_t(1) << (row % 64); }
+
+  /// @brief counts the selected rows
+  /// @return the number of selected rows
+  size_t count() const;
+
+  /// @brief gets the indexes of the selected rows
+  /// @return the indexes in ascending order
+  vector<size_t> getRowIndexes() const;
+
+  /// @brief keeps only the rows selected by both selections
+  Selection& operator&=(const Selection& other);
+
+  /// @brief selects the rows selected by either selection
+  Selection& operator|=(const Selection& other);
+
+  /// @brief selects exactly the rows that were not selected
+  void invert();
+
+  /// @brief gets the words of the bitmap, row i is bit i % 64 of word i / 64
+  /// @return the words
+  vector<uint64_t>& getWords() { return words; }
+  const vector<uint64_t>& getWords() const { return words; }
+
+ private:
+  // the bits of the rows, the bits past the last row are always 0
+  vector<uint64_t> words;
+  // the number of rows covered
+  size_t rowCount;
+};
+
+/// @brief Class for a condition on the rows of a table, built from
+/// comparisons on columns combined with &&, || and !, the condition is
+/// evaluated a column at a time into a Selection
+class Predicate {
+ public:
+  /// @brief compares the numbers of a float column with a number, missing
+  /// numbers never match
+  /// @param header the header of the column
+  /// @param op the comparison
+  /// @param value the number to compare with
+  static Predicate compare(const string& header, CompareOp op, double value);
+
+  /// @brief compares the strings of a string column with a string in
+  /// lexicographic order
+  /// @param header the header of the column
+  /// @param op the comparison
+  /// @param value the string to compare with
+  static Predicate compare(const string& header, CompareOp op,
+                           const string& value);
+
+  /// @brief matches the numbers of a float column between low and high,
+  /// both included
+  /// @param header the header of the column
+  /// @param low the smallest number to match
+  /// @param high the biggest number to match
+  static Predicate between(const string& header, double low, double high);
+
+  /// @brief matches the strings of a string column that start with prefix
+  /// @param header the header of the column
+  /// @param prefix the start to match
+  static Predicate startsWith(const string& header, const string& prefix);
+
+  /// @brief matches the rows both predicates match
+  Predicate operator&&(const Predicate& other) const;
+
+  /// @brief matches the rows either predicate matches
+  Predicate operator||(const Predicate& other) const;
+
+  /// @brief matches the rows the predicate does not match
+  Predicate operator!() const;
+
+  /// @brief evaluates the predicate on every row of a table, rows pending
+  /// deletion are deleted first so the selection holds positions
+  /// @param table the table to evaluate on
+  /// @return the rows that match, by their index in the table
+  Selection evaluate(Table& table) const;
+
+ private:
+  // the kinds of nodes of a predicate
+  enum Kind { numberNode, stringNode, rangeNode, prefixNode, andNode,
+              orNode, notNode };
+  // a comparison on a column, or a combination of other nodes
+  struct Node {
+    Kind kind;
+    string header;
+    CompareOp op = equalTo;
+    double low = 0, high = 0;
+    string text;
+    shared_ptr<const Node> left, right;
+  };
+  // the nodes are never changed once built, so predicates share them
+  shared_ptr<const Node> node;
+
+  Predicate(shared_ptr<const Node> root) : node(move(root)) {}
+
+  // views evaluate predicates without deleting the rows pending deletion
+  friend class TableView;
+
+  // evaluates a node on every row of a table, rows pending deletion included
+  static Selection evaluateNode(const Node& node, const Table& table);
+  // evaluates a comparison on a column
+  static void evaluateColumn(const Node& node, const Column& col,
+                             Selection& selection);
+};
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef TABLUZZY_INDEX_HPP
+#define TABLUZZY_INDEX_HPP
+
+#include <cstddef>
+#include <functional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "chunks.hpp"
+using namespace std;
+
+/// @brief the rows moved by a run of inserts and deletes, kept as the offset
+/// every range of old rows moved by, so that moving the rows of an index
+/// waits for the next lookup
+class RowShifts {
+ public:
+  /// @brief moves every row at position from on by delta
+  /// @param from the first position that moved
+  /// @param delta the number of positions the rows moved by
+  void shift(size_t from, ptrdiff_t delta);
+
+  /// @brief finds the position an old row moved to
+  /// @param row the old row
+  /// @return the position of the row
+  size_t apply(size_t row) const;
+
+  /// @brief finds the old row that moved to a position, rows deleted before
+  /// it moved to the same position so the last one is the row still there
+  /// @param position the position of the row
+  /// @param row set to the old row
+  /// @return whether an old row moved to the position
+  bool invert(size_t position, size_t& row) const;
+
+  /// @brief the number of ranges of rows that moved apart
+  size_t size() const { return ranges.size(); }
+
+  /// @brief forgets every move
+  void clear() { ranges.clear(); }
+
+ private:
+  // the first old row of every range and its offset, sorted by row, rows
+  // before the first range did not move
+  vector<pair<size_t, ptrdiff_t>> ranges;
+};
+
+/// @brief hash index over the values of a string column, mapping every
+/// distinct value to the rows that hold it in ascending order
+class StringIndex {
+ public:
+  /// @brief rebuilds the index from every value of a column
+  /// @param count the number of rows of the column
+  /// @param valueAt gets the value at a row of the column
+  void build(size_t count, const function<string_view(size_t)>& valueAt);
+
+  /// @brief adds a row holding value to the index
+  /// @param value the value of the row
+  /// @param row the index of the row
+  void add(string_view value, size_t row);
+
+  /// @brief removes a row holding value from the index
+  /// @param value the value of the row
+  /// @param row the index of the row
+  void remove(string_view value, size_t row);
+
+  /// @brief moves every indexed row from row from on by delta, after rows
+  /// were inserted or deleted before them, the rows are only moved by the
+  /// next flush
+  /// @param from the first row that moved
+  /// @param delta the number of positions the rows moved by
+  void shift(size_t from, ptrdiff_t delta);
+
+  /// @brief moves the rows by every shift since the last flush in one pass,
+  /// which lookups need first
+  void flush();
+
+  /// @brief the number of moves and rows kept aside until the next flush
+  size_t getPendingEdits() const { return shifts.size() + added.size(); }
+
+  /// @brief finds the first row holding value in constant time
+  /// @param value the value to search for
+  /// @return the index of the first row, -1 if no row holds the value
+  int first(string_view value) const;
+
+  /// @brief finds every row holding value in constant time
+  /// @param value the value to search for
+  /// @return the indexes of the rows in ascending order
+  vector<size_t> all(string_view value) const;
+
+  /// @brief empties the index
+  void clear();
+
+ private:
+  // hashes strings and views of strings alike, so lookups never copy
+  struct Hash {
+    using is_transparent = void;
+    size_t operator()(string_view value) const {
+      return hash<string_view>{}(value);
+    }
+  };
+  // every distinct value and its rows
+  unordered_map<string, vector<size_t>, Hash, equal_to<>> rows;
+  // the moves of the rows since the last flush
+  RowShifts shifts;
+  // the rows added since the last flush, at their current position
+  vector<pair<string, size_t>> added;
+  // adds a row to the lists of rows
+  void insert(string_view value, size_t row);
+};
+
+/// @brief sorted index over the values of a float column, missing numbers
+/// (NaN) are never indexed
+class NumberIndex {
+ public:
+  /// @brief rebuilds the index from every value of a column
+  /// @param values the values of the column
+  void build(const ChunkedVector<double>& values);
+
+  /// @brief adds a row holding value to the index
+  /// @param value the value of the row
+  /// @param row the index of the row
+  void add(double value, size_t row);
+
+  /// @brief removes a row holding value from the index
+  /// @param value the value of the row
+  /// @param row the index of the row
+  void remove(double value, size_t row);
+
+  /// @brief moves every indexed row from row from on by delta, after rows
+  /// were inserted or deleted before them, the rows are only moved by the
+  /// next flush
+  /// @param from the first row that moved
+  /// @param delta the number of positions the rows moved by
+  void shift(size_t from, ptrdiff_t delta);
+
+  /// @brief moves the rows by every shift since the last flush in one pass,
+  /// which lookups need first
+  void flush();
+
+  /// @brief the number of moves and rows kept aside until the next flush
+  size_t getPendingEdits() const { return shifts.size() + added.size(); }
+
+  /// @brief finds the first row holding value in logarithmic time
+  /// @param value the value to search for
+  /// @return the index of the first row, -1 if no row holds the value
+  int first(double value) const;
+
+  /// @brief finds every row holding value in logarithmic time
+  /// @param value the value to search for
+  /// @return the indexes of the rows in ascending order
+  vector<size_t> all(double value) const;
+
+  /// @brief finds every row holding a value between low and high, both
+  /// included, in logarithmic time
+  /// @param low the smallest value to find
+  /// @param high the biggest value to find
+  /// @return the indexes of the rows in ascending order
+  vector<size_t> range(double low, double high) const;
+
+  /// @brief empties the index
+  void clear();
+
+ private:
+  // an indexed row, shifting rows keeps their order, so the row can change
+  // in place without moving the entry in the set
+  struct Entry {
+    double value;
+    mutable size_t row;
+    bool operator<(const Entry& other) const {
+      return (value != other.value) ? value < other.value : row < other.row;
+    }
+  };
+  // every indexed row with its value, ordered by value and then by row
+  set<Entry> entries;
+  // the moves of the rows since the last flush
+  RowShifts shifts;
+  // the rows added since the last flush, at their current position
+  vector<Entry> added;
+};
+
+#endif
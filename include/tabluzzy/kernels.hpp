@@ -0,0 +1,71 @@
+#ifndef TABLUZZY_KERNELS_HPP
+#define TABLUZZY_KERNELS_HPP
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+using namespace std;
+
+// Enum to represent the instruction set the numerical kernels run with
+// noSimd = portable scalar code
+// avx2 = 256 bit AVX2 vectors
+// avx512 = 512 bit AVX-512 vectors
+enum SimdLevel { noSimd = 0, avx2 = 1, avx512 = 2 };
+
+/// @brief running moments of a sequence of numbers and of their row indexes,
+/// the moments of separate blocks of numbers merge into the moments of the
+/// blocks together
+struct Moments {
+  // the number of values
+  size_t count = 0;
+  // the sum of the values, with the running error of the sum kept apart
+  double sum = 0, compensation = 0;
+  // the smallest and the biggest value
+  double min = numeric_limits<double>::infinity();
+  double max = -numeric_limits<double>::infinity();
+  // the mean of the values and their sum of squared deviations from it
+  double mean = 0, m2 = 0;
+  // the mean of the row indexes and their sum of squared deviations from it
+  double meanX = 0, m2x = 0;
+  // the sum of the products of the deviations of the values and row indexes
+  double cxy = 0;
+
+  /// @brief merges the moments of another block into these moments
+  /// @param other the moments of the other block
+  void merge(const Moments& other);
+
+  /// @brief adds a single number to the moments, a missing number (NaN) is
+  /// left out
+  /// @param value the number to add
+  /// @param row the row index of the number
+  void add(double value, size_t row);
+
+  /// @brief gets the compensated sum of the values
+  /// @return the sum of the values
+  double getSum() const { return sum + compensation; }
+};
+
+/// @brief computes the moments of a contiguous block of numbers with the
+/// fastest kernels the processor supports, missing numbers (NaN) are left out
+/// @param values the first of the numbers
+/// @param count the number of numbers
+/// @param firstRow the row index of the first number
+/// @return the moments of the numbers
+Moments computeMoments(const double* values, size_t count, size_t firstRow);
+
+/// @brief computes the median of values by selection, reordering them and
+/// leaving out missing numbers (NaN)
+/// @param values the values to get the median of
+/// @return the median of the values
+double selectMedian(vector<double>& values);
+
+/// @brief gets the instruction set the kernels currently run with
+/// @return the current instruction set
+SimdLevel getSimdLevel();
+
+/// @brief selects the instruction set the kernels run with, levels the
+/// processor does not support fall back to the best supported level
+/// @param level the instruction set to run with
+void setSimdLevel(SimdLevel level);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef TABLUZZY_MAPPING_HPP
+#define TABLUZZY_MAPPING_HPP
+
+#include <cstddef>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TABLUZZY_HAS_MMAP 1
+#endif
+
+using namespace std;
+
+#ifdef TABLUZZY_HAS_MMAP
+/// @brief Read only memory mapping of a whole file that is unmapped again
+/// when it goes out of scope, pages are only read once they are touched
+struct MappedFile {
+  // the mapped bytes, or nullptr if the file could not be mapped
+  const char* bytes = nullptr;
+  // the size of the mapping
+  size_t size = 0;
+
+  MappedFile(const string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+      void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapped != MAP_FAILED) {
+        bytes = static_cast<const char*>(mapped);
+        size = info.st_size;
+      }
+    }
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+  }
+  ~MappedFile() {
+    if (bytes) munmap(const_cast<char*>(bytes), size);
+  }
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+};
+#endif
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef TABLUZZY_METRICS_HPP
+#define TABLUZZY_METRICS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+using namespace std;
+
+// Enum to represent the operations the instrumentation times
+// csvLoadTimer = loading csv, from lines, streams and files
+// csvExportTimer = writing csv
+// htmlExportTimer = writing html
+// displayTimer = drawing tables and columns to the terminal
+// sortTimer = sorting the rows of tables
+// statisticsTimer = computing the statistics of columns and tables
+// snapshotTimer = writing and reading snapshots
+// filterTimer = evaluating predicates and filtering tables
+// groupByTimer = grouping the rows of tables and aggregating the groups
+// joinTimer = joining tables on their keys
+enum MetricTimer {
+  csvLoadTimer = 0,
+  csvExportTimer = 1,
+  htmlExportTimer = 2,
+  displayTimer = 3,
+  sortTimer = 4,
+  statisticsTimer = 5,
+  snapshotTimer = 6,
+  filterTimer = 7,
+  groupByTimer = 8,
+  joinTimer = 9,
+  TIMER_COUNT = 10
+};
+
+// Enum to represent the quantities the instrumentation counts
+// bytesAllocated = bytes of chunks and string blocks allocated by columns
+// rowsScanned = rows visited by statistics, lookups, sorts and exports
+// numberConversions = numbers parsed from text or formatted as text
+// columnCopies = columns copied as a whole
+enum MetricCounter {
+  bytesAllocated = 0,
+  rowsScanned = 1,
+  numberConversions = 2,
+  columnCopies = 3,
+  COUNTER_COUNT = 4
+};
+
+/// @brief the number of times an operation ran and the time it took
+struct TimerStats {
+  uint64_t calls = 0;
+  uint64_t nanoseconds = 0;
+};
+
+/// @brief the timers and counters of every thread summed up
+struct Metrics {
+  // false if the library was built without instrumentation, every timer and
+  // counter is then zero
+  bool enabled = false;
+  TimerStats timers[TIMER_COUNT];
+  uint64_t counters[COUNTER_COUNT] = {};
+
+  /// @brief gets a timer
+  /// @param timer the timer to get
+  /// @return the calls and time of the timer
+  const TimerStats& getTimer(MetricTimer timer) const { return timers[timer]; }
+
+  /// @brief gets a counter
+  /// @param counter the counter to get
+  /// @return the value of the counter
+  uint64_t getCounter(MetricCounter counter) const {
+    return counters[counter];
+  }
+
+  /// @brief writes every timer and counter as a json object
+  /// @return the json text
+  string to_json() const;
+};
+
+/// @brief gets the timers and counters collected since the last reset
+/// @return the metrics of every thread together
+Metrics getMetrics();
+
+/// @brief sets every timer and counter back to zero
+void resetMetrics();
+
+/// @brief adds to a counter of the calling thread
+/// @param counter the counter to add to
+/// @param amount the amount to add
+void addToCounter(MetricCounter counter, uint64_t amount);
+
+/// @brief adds a call and its duration to a timer of the calling thread
+/// @param timer the timer to add to
+/// @param nanoseconds the duration of the call
+void addToTimer(MetricTimer timer, uint64_t nanoseconds);
+
+/// @brief Class that times the scope it lives in
+class ScopedTimer {
+ public:
+  ScopedTimer(MetricTimer t) : timer(t), start(chrono::steady_clock::now()) {}
+  ~ScopedTimer() {
+    auto elapsed = chrono::steady_clock::now() - start;
+    addToTimer(timer,
+               chrono::duration_cast<chrono::nanoseconds>(elapsed).count());
+  }
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+ private:
+  MetricTimer timer;
+  chrono::steady_clock::time_point start;
+};
+
+// the instrumentation is only compiled in when TABLUZZY_METRICS is defined, by
+// the METRICS option of the build, otherwise the macros expand to nothing
+#ifdef TABLUZZY_METRICS
+#define TABLUZZY_TIME(timer) ScopedTimer tabluzzyScopedTimer(timer)
+#define TABLUZZY_COUNT(counter, amount) addToCounter(counter, amount)
+
+/// @brief member that counts the copies of the column holding it
+struct CopyCounter {
+  CopyCounter() = default;
+  CopyCounter(const CopyCounter&) { addToCounter(columnCopies, 1); }
+  CopyCounter& operator=(const CopyCounter&) {
+    addToCounter(columnCopies, 1);
+    return *this;
+  }
+};
+#else
+#define TABLUZZY_TIME(timer) ((void)0)
+#define TABLUZZY_COUNT(counter, amount) ((void)0)
+
+struct CopyCounter {};
+#endif
+
+#endif
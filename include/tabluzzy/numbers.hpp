@@ -0,0 +1,81 @@
+#ifndef TABLUZZY_NUMBERS_HPP
+#define TABLUZZY_NUMBERS_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+using namespace std;
+
+// Enum to represent the outcome of reading a number from text
+// parsedNumber = the text held a number
+// nullNumber = the text was empty or nan, a missing number
+// invalidNumber = the text was not a number
+enum ParseStatus { parsedNumber = 0, nullNumber = 1, invalidNumber = 2 };
+
+// the number of characters formatNumber writes at most
+static constexpr size_t NUMBER_BUFFER_SIZE = 32;
+
+/// @brief reads a number from text without depending on the locale and
+/// without throwing, blanks around the number and a leading plus sign are
+/// allowed
+/// @param text the text to read
+/// @param value set to the number, or to NaN if the text held no number
+/// @return whether the text held a number, a missing number or neither
+ParseStatus parseNumber(string_view text, double& value);
+
+/// @brief reads a count of rows or columns from text
+/// @param text the text to read
+/// @param count set to the count
+/// @return true if the text held a count, false if it did not
+bool parseCount(string_view text, size_t& count);
+
+/// @brief writes a number as the shortest text that reads back as the same
+/// number, without depending on the locale, missing numbers (NaN) are written
+/// as empty text
+/// @param value the number to write
+/// @param buffer room for NUMBER_BUFFER_SIZE characters
+/// @return the number of characters written
+size_t formatNumber(double value, char* buffer);
+
+/// @brief writes a number as text like formatNumber
+/// @param value the number to write
+/// @return the text of the number
+string formatNumber(double value);
+
+/// @brief counts the cells of a load that held no number or held text that is
+/// not a number, both are stored as NaN
+struct ParseReport {
+  // the number of cells holding a missing number
+  size_t nullCells = 0;
+  // the number of cells holding text that is not a number
+  size_t invalidCells = 0;
+  // the row and column of the first cell that was not a number
+  size_t firstInvalidRow = 0, firstInvalidColumn = 0;
+
+  /// @brief counts the outcome of reading a cell
+  /// @param status the outcome
+  /// @param row the row of the cell
+  /// @param column the column of the cell
+  void add(ParseStatus status, size_t row, size_t column) {
+    if (status == nullNumber) {
+      nullCells++;
+    } else if (status == invalidNumber && invalidCells++ == 0) {
+      firstInvalidRow = row;
+      firstInvalidColumn = column;
+    }
+  }
+
+  /// @brief counts the cells of a report of later rows
+  /// @param other the report of the later rows
+  /// @param firstRow the row the rows of other start at
+  void merge(const ParseReport& other, size_t firstRow) {
+    nullCells += other.nullCells;
+    if (invalidCells == 0 && other.invalidCells != 0) {
+      firstInvalidRow = firstRow + other.firstInvalidRow;
+      firstInvalidColumn = other.firstInvalidColumn;
+    }
+    invalidCells += other.invalidCells;
+  }
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef TABLUZZY_PARALLEL_HPP
+#define TABLUZZY_PARALLEL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+/// @brief Class for a pool of worker threads that the parallel operations of
+/// the library share, the thread that starts a job always works on it too so
+/// jobs started from inside other jobs cannot deadlock
+class ThreadPool {
+ public:
+  /// @brief constructor member, starts the worker threads
+  /// @param threadCount the number of threads working on every job, including
+  /// the thread that starts the job
+  ThreadPool(size_t threadCount);
+
+  // destructor member, stops and joins the worker threads
+  ~ThreadPool();
+
+  /// @brief gets the number of threads working on every job
+  /// @return the number of threads
+  size_t getThreadCount() const;
+
+  /// @brief runs task(i) for every i in [0, count) on the threads of the pool
+  /// and waits for all of them, indexes are handed out one at a time so
+  /// uneven tasks balance themselves, the first exception thrown by a task is
+  /// rethrown here
+  /// @param count the number of tasks
+  /// @param task the task to run for every index
+  void parallelFor(size_t count, const function<void(size_t)>& task);
+
+ private:
+  // a call to parallelFor that the threads take indexes from
+  struct Job {
+    size_t count;
+    const function<void(size_t)>* task;
+    atomic<size_t> next{0}, finished{0};
+    exception_ptr error;
+  };
+
+  // the number of threads working on every job
+  size_t threadCount;
+  // the worker threads
+  vector<thread> workers;
+  // the jobs that still have indexes to hand out
+  deque<shared_ptr<Job>> jobs;
+  // guards jobs and stopping
+  mutex lock;
+  // wakes the workers when a job arrives and the callers when a job is done
+  condition_variable wake, done;
+  // set when the pool is destroyed
+  bool stopping = false;
+
+  // the loop of the worker threads
+  void work();
+  // runs indexes of the job until there are none left
+  void runJob(Job& job);
+};
+
+/// @brief gets the pool shared by the library, created on first use with one
+/// thread per hardware thread
+/// @return the shared pool
+ThreadPool& getThreadPool();
+
+/// @brief sets the number of threads of the shared pool, must not be called
+/// while a parallel operation is running
+/// @param threadCount the number of threads, 0 for one per hardware thread
+void setThreadCount(size_t threadCount);
+
+/// @brief gets the number of threads of the shared pool
+/// @return the number of threads
+size_t getThreadCount();
+
+#endif
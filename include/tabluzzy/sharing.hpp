@@ -0,0 +1,22 @@
+#ifndef TABLUZZY_SHARING_HPP
+#define TABLUZZY_SHARING_HPP
+
+#include <atomic>
+#include <memory>
+using namespace std;
+
+/// @brief checks if a pointer is the only owner of the storage it points to,
+/// storage shared by copies of a column is copied before it is modified, while
+/// storage with a single owner is modified in place
+/// @param storage the pointer to the storage
+/// @return true if no other pointer owns the storage
+template <typename T>
+bool isOnlyOwner(const shared_ptr<T>& storage) {
+  if (storage.use_count() != 1) return false;
+  // the owners that let go of the storage on other threads may have read it
+  // just before, letting go releases the storage and this acquires it
+  atomic_thread_fence(memory_order_acquire);
+  return true;
+}
+
+#endif
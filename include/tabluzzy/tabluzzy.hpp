@@ -2,16 +2,99 @@
 #define TABLUZZY_HPP
 
 #include <statsi/statsi.hpp>  // library of statistical functions to be used in program written by Mubarak
+#include <atomic>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <span>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <variant>
 #include <vector>
+
+#include "arena.hpp"       // arena behind the strings of the columns
+#include "chunks.hpp"      // chunked storage behind the columns
+#include "dictionary.hpp"  // dictionaries of dictionary encoded columns
+#include "filter.hpp"      // predicates and selections of rows
+#include "index.hpp"       // secondary indexes for the lookups
+#include "kernels.hpp"     // vectorized numerical kernels behind the statistics
+#include "metrics.hpp"     // opt-in timers and counters
+#include "numbers.hpp"     // conversions between text and numbers
+#include "parallel.hpp"    // thread pool shared by the parallel operations
+#include "view.hpp"        // read only views of tables
+#include "writer.hpp"      // buffered output of the exports
 using namespace std;
 
+#ifdef TABLUZZY_ARROW
+// arrow tables are only used through pointers, so arrow/api.h is left to the
+// sources that need it
+namespace arrow {
+class Table;
+}
+#endif
+
 // Enum to represent the data types of columns
 // str = strings
 // flt = float / numerical values
 enum ValueType { str = 0, flt = 1 };
 
+// Enum to represent how a string column stores its values
+// plainEncoding = every row holds its own string
+// dictionaryEncoding = every row holds an integer code into a dictionary of
+// the distinct values
+// automaticEncoding = dictionary encoded while the column holds few distinct
+// values, plain otherwise
+enum StringEncoding {
+  plainEncoding = 0,
+  dictionaryEncoding = 1,
+  automaticEncoding = 2
+};
+
+// Enum to represent the order rows are sorted in
+enum SortOrder { ascending = 0, descending = 1 };
+
+// Enum to represent the rows a join keeps
+// innerJoin = only the rows whose key is found in both tables
+// leftJoin = every row of the left table, with missing values where its key
+// is not found in the right table
+enum JoinType { innerJoin = 0, leftJoin = 1 };
+
+/// @brief one key of a sort, the column to sort by and the order to sort in
+struct SortKey {
+  // the header of the column to sort by
+  string header;
+  // the order to sort that column in
+  SortOrder order = ascending;
+};
+
+/// @brief statistics of the numbers in a column, computed together in a single
+/// pass over the values
+struct ColumnStats {
+  // the number of values
+  size_t count = 0;
+  // the sum of the values
+  double sum = 0;
+  // the smallest and the biggest value
+  double min = 0, max = 0;
+  // the mean of the values
+  double mean = 0;
+  // the population variance of the values and its square root
+  double variance = 0, stdDeviation = 0;
+  // the median of the values
+  double median = 0;
+  // the least squares line through the values against their row index x,
+  // Y = intercept + slope * x
+  double intercept = 0, slope = 0;
+};
+
+/// @brief derives every statistic but the median from the moments of the
+/// numbers, the statistics of no numbers are all NaN
+/// @param moments the moments of the numbers
+/// @return the statistics of the numbers, with a median of 0
+ColumnStats statsFromMoments(const Moments& moments);
+
 /// @brief Class for column, used to store the values of the column of the table
 /// and to interact with those values on a column by column basis
 class Column {
@@ -28,17 +111,55 @@ class Column {
   /// using the [] operator
   /// @param rowNo the index of the row number to access
   /// @return the string representing the value at that row index
-  string& operator[](size_t rowNo);
+  string operator[](size_t rowNo) const;
 
   /// @brief returns the value at row index rowNo
   /// @param rowNothe index of the row number to access
   /// @return the string representing the value at that row index
-  string getValueAt(size_t rowNo);
+  string getValueAt(size_t rowNo) const;
 
-  /// @brief sets the value at row index rowNo to the value
+  /// @brief returns the numerical value at row index rowNo of a float column
+  /// @param rowNo the index of the row number to access
+  /// @return the number stored at that row index
+  double getNumberAt(size_t rowNo) const;
+
+  /// @brief appends the text of the value at row index rowNo to out, without
+  /// building a temporary string
+  /// @param rowNo the index of the row
+  /// @param out the string to append to
+  void appendValueAt(size_t rowNo, string& out) const;
+
+  /// @brief returns a view of the text at row index rowNo of a string column
+  /// without copying it, the view is valid until the column is modified
+  /// @param rowNo the index of the row number to access
+  /// @return a view of the string stored at that row index
+  string_view getStringAt(size_t rowNo) const;
+
+  /// @brief calls visit with the numbers of a float column as contiguous
+  /// read only blocks, in row order, without copying them
+  /// @param visit callable taking a span<const double>
+  template <typename Visitor>
+  void forEachNumberBlock(Visitor&& visit) const {
+    numbers.forEachChunk(visit);
+  }
+
+  /// @brief sets the value at row index rowNo to the value, a plain string
+  /// is stored next to the other strings and the bytes of the string it
+  /// replaces are reclaimed once they make up most of the stored bytes
   /// @param rowNo the index of the row to set
   /// @param value the value to set the row to
-  void setValueAt(size_t rowNo, string value);
+  void setValueAt(size_t rowNo, const string& value);
+
+  /// @brief sets the value at row index rowNo to the value, the same as the
+  /// overload above as the text is copied into the storage of the column
+  /// @param rowNo the index of the row to set
+  /// @param value the value to set the row to
+  void setValueAt(size_t rowNo, string&& value);
+
+  /// @brief sets the numerical value at row index rowNo of a float column
+  /// @param rowNo the index of the row to set
+  /// @param value the number to set the row to
+  void setNumberAt(size_t rowNo, double value);
 
   /// @brief sets the header of the column to header
   /// @param header the new header
@@ -46,7 +167,7 @@ class Column {
 
   /// @brief gets the header of the column
   /// @return the header of the column
-  string getHeader();
+  const string& getHeader() const;
 
   /// @brief returns the prime numbers in a column
   /// @return the prime numbers in the column
@@ -58,7 +179,7 @@ class Column {
 
   /// @brief gets the index of the table
   /// @return the new index of the column
-  int getIndex();
+  int getIndex() const;
 
   /// @brief sets the datatype of the column to the new datatype
   /// @param datatype the new datatype to set it to
@@ -66,42 +187,102 @@ class Column {
 
   /// @brief gets the value type of the column
   /// @return the datatype of the column
-  ValueType getValueType();
+  ValueType getValueType() const;
 
   /// @brief displays the values in the column
-  void displayColumn();
+  void displayColumn() const;
 
   /// @brief gets the minimum value in the column
   /// @return the minimum value in the column
-  float getMinimumValue();
+  float getMinimumValue() const;
 
   /// @brief  gets the maximum value i nthe column
   /// @return the maximum value in the column
-  float getMaximumValue();
+  float getMaximumValue() const;
 
   /// @brief  gets the median value in the column
   /// @return the median value in the column
-  float getMedian();
+  float getMedian() const;
 
   /// @brief gets the mean value in the column
   /// @return the mean value in the column
-  float getMean();
+  float getMean() const;
 
   /// @brief gets the variance of all values in the column
   /// @return the variance of the values in the column
-  float getVariance();
+  float getVariance() const;
 
   /// @brief adds a value to the last row in column
   /// @param value the value to add
-  void pushValue(string value);
+  void pushValue(const string& value);
+
+  /// @brief adds a value to the last row in column, the same as the overload
+  /// above as the text is copied into the storage of the column
+  /// @param value the value to add
+  void pushValue(string&& value);
+
+  /// @brief adds a number to the last row of a float column
+  /// @param value the number to add
+  void pushNumber(double value);
+
+  /// @brief adds a string to the last row of a string column, the text is
+  /// only copied if the column has to store it
+  /// @param value the string to add
+  void pushString(string_view value);
+
+  /// @brief moves the first count rows of other to the end of the column,
+  /// the bytes of plain strings are moved without being copied and other is
+  /// left empty
+  /// @param other the column to take the rows of
+  /// @param count the number of rows to take
+  void appendRows(Column& other, size_t count);
+
+  /// @brief appends copies of the rows of other at rowIndexes, in the order
+  /// of rowIndexes, an index of MISSING_ROW appends a missing value
+  /// @param other the column to copy the rows of
+  /// @param rowIndexes the indexes of the rows to copy
+  void appendRowsAt(const Column& other, span<const size_t> rowIndexes);
+
+  // the row index appendRowsAt reads as a missing value
+  static constexpr size_t MISSING_ROW = SIZE_MAX;
+
+  /// @brief reserves storage for rowCount rows in the column
+  /// @param rowCount the number of rows to reserve
+  void reserve(size_t rowCount);
+
+  /// @brief gets the number of rows in the column
+  /// @return the number of rows in the column
+  size_t getNumberOfRows() const;
 
   /// @brief gets the standard deviation of all the values in the column
   /// @return the standard deviation
-  float getStdDeviation();
+  float getStdDeviation() const;
 
   /// @brief gets the regression values for the values in the colun
   /// @return gets the regression values for the values in the column
-  tuple<float, float> getRegression();
+  tuple<float, float> getRegression() const;
+
+  /// @brief gets every statistic of the column, computed in a single pass
+  /// the first time and cached until the column is modified
+  /// @return the statistics of the column
+  const ColumnStats& getStats() const;
+
+  /// @brief gets the mergeable moments of the numbers in the column, cached
+  /// together with the statistics
+  /// @return the moments of the column
+  const Moments& getMoments() const;
+
+  /// @brief computes the statistics of the column without the rows marked in
+  /// skip, bypassing the cache
+  /// @param skip one flag per row, true for rows to leave out
+  /// @return the statistics of the other rows
+  ColumnStats getStats(const vector<bool>& skip) const;
+
+  /// @brief computes the moments of the column without the rows marked in
+  /// skip, bypassing the cache
+  /// @param skip one flag per row, true for rows to leave out
+  /// @return the moments of the other rows
+  Moments getMoments(const vector<bool>& skip) const;
 
   /// @brief gets all the values in the column
   /// @return a list of all the values in the column
@@ -114,7 +295,108 @@ class Column {
   /// @brief insert a row at index rowIndex with value value
   /// @param rowIndex the rowIndex of the row to insert
   /// @param value the value of the new rowIndex
-  void insertAtRowIndex(size_t rowIndex, string value);
+  void insertAtRowIndex(size_t rowIndex, const string& value);
+
+  /// @brief insert a row at index rowIndex with value value, the same as the
+  /// overload above as the text is copied into the storage of the column
+  /// @param rowIndex the rowIndex of the row to insert
+  /// @param value the value of the new rowIndex
+  void insertAtRowIndex(size_t rowIndex, string&& value);
+
+  /// @brief compares the values at two row indexes of the column, numbers
+  /// compare numerically with missing numbers last and strings compare
+  /// lexicographically
+  /// @param rowIndex1 the index of the first row
+  /// @param rowIndex2 the index of the second row
+  /// @return a negative value, zero or a positive value if the first row is
+  /// smaller than, equal to or bigger than the second row
+  int compareRows(size_t rowIndex1, size_t rowIndex2) const;
+
+  /// @brief prepares the column for many calls to compareRows, so the rows of
+  /// a dictionary encoded column compare as integers
+  void prepareCompare() const;
+
+  /// @brief hashes the value at a row, rows that compareRows finds equal
+  /// hash alike
+  /// @param rowNo the index of the row
+  /// @return the hash of the value
+  size_t hashRow(size_t rowNo) const;
+
+  /// @brief hashes the value at every row, equal values hash alike in every
+  /// column of the same datatype however they are stored
+  /// @return the hash of every row
+  vector<size_t> getValueHashes() const;
+
+  /// @brief changes how a string column stores its values, automaticEncoding
+  /// encodes the column if at most half of its values are distinct and
+  /// keeps checking as rows are appended
+  /// @param encoding the encoding to use
+  void setStringEncoding(StringEncoding encoding);
+
+  /// @brief gets how the string column currently stores its values
+  /// @return plainEncoding or dictionaryEncoding
+  StringEncoding getStringEncoding() const;
+
+  /// @brief gets the number of distinct values of a dictionary encoded column
+  /// @return the size of the dictionary, 0 if the column is not encoded
+  size_t getDictionarySize() const;
+
+  /// @brief gets the number of bytes the arena of a plain string column
+  /// holds, including the bytes of overwritten and deleted strings that were
+  /// not reclaimed yet
+  /// @return the number of bytes held, 0 for other columns
+  size_t getStringBytes() const;
+
+  /// @brief swaps the values at two row indexes of the column
+  /// @param rowIndex1 the index of the first row
+  /// @param rowIndex2 the index of the second row
+  void swapRows(size_t rowIndex1, size_t rowIndex2);
+
+  /// @brief reorders the column so that row i holds the value that was at row
+  /// permutation[i]
+  /// @param permutation the source row index of every row
+  void applyPermutation(const vector<size_t>& permutation);
+
+  /// @brief builds a secondary index over the values of the column, a hash
+  /// index for string columns and a sorted index for float columns, that is
+  /// kept up to date by every mutator until it is dropped
+  void createIndex();
+
+  /// @brief drops the secondary index of the column
+  void dropIndex();
+
+  /// @brief checks if the column has a secondary index
+  /// @return true if it has one, false if it doesnt
+  bool hasIndex() const;
+
+  /// @brief finds the first row of a string column holding value, in
+  /// constant time if the column is indexed
+  /// @param value the value to search for
+  /// @return the index of the first row, -1 if no row holds the value
+  int findFirstRow(string_view value) const;
+
+  /// @brief finds the first row of a float column holding value, in
+  /// logarithmic time if the column is indexed
+  /// @param value the value to search for
+  /// @return the index of the first row, -1 if no row holds the value
+  int findFirstRow(double value) const;
+
+  /// @brief finds every row of a string column holding value
+  /// @param value the value to search for
+  /// @return the indexes of the rows in ascending order
+  vector<size_t> findAllRows(string_view value) const;
+
+  /// @brief finds every row of a float column holding value
+  /// @param value the value to search for
+  /// @return the indexes of the rows in ascending order
+  vector<size_t> findAllRows(double value) const;
+
+  /// @brief finds every row of a float column holding a value between low and
+  /// high, both included, in logarithmic time if the column is indexed
+  /// @param low the smallest value to find
+  /// @param high the biggest value to find
+  /// @return the indexes of the rows in ascending order
+  vector<size_t> findRowsInRange(double low, double high) const;
 
   // private memebers of the class Column
  private:
@@ -122,10 +404,88 @@ class Column {
   int index;
   // the header of the column
   string header;
-  // the values of the column, stored in string
-  vector<string> rows;
+  // the values of a string column, as locations of their bytes in the arena
+  ChunkedVector<StrRef> rows;
+  // the bytes of the strings of a string column, held in a few large blocks
+  StringArena arena;
+  // the values of a float column, stored natively so statistics never have
+  // to parse text
+  ChunkedVector<double> numbers;
+  // the values of a dictionary encoded string column, as codes into the
+  // dictionary
+  ChunkedVector<uint32_t> codes;
+  // the distinct values of a dictionary encoded string column, shared with
+  // the copies of the column until one of them adds a value
+  shared_ptr<Dictionary> dictionary;
+  // whether the string column is dictionary encoded
+  bool encoded = false;
+  // whether the encoding is rechecked as rows are appended
+  bool encodedAutomatically = false;
+  // decodes an automatically encoded column that turned out to hold too many
+  // distinct values
+  void checkEncoding();
+  // copies the strings of a plain column into a new arena once most of the
+  // bytes of the arena belong to strings that were overwritten or deleted
+  void reclaimStrings();
+  // gets the code of value, copying a shared dictionary before the value is
+  // added to it
+  uint32_t encodeValue(string_view value);
+
+  // the snapshot reader and writer handle the storage directly
+  friend class Snapshot;
+  // and so does the conversion to and from arrow
+  friend class ArrowBridge;
+  // predicates scan the storage a chunk at a time
+  friend class Predicate;
+  // tables point their columns at the counter of their headers
+  friend class Table;
+  // counts the copies of the column when the instrumentation is built in
+  [[no_unique_address]] CopyCounter copies;
   // the datatype of the columnƒ
   ValueType type;
+  // the header counter of the table holding the column, incremented by
+  // every call to setHeader, null for a column outside of a table
+  shared_ptr<atomic<size_t>> headerGeneration;
+  // the cached statistics of the column and the moments they came from
+  mutable ColumnStats stats;
+  mutable Moments moments;
+  // whether the cached statistics, and separately the median, are up to date
+  mutable bool statsValid = false, medianValid = false;
+
+  // marks the cached statistics as out of date, called by every mutator
+  void invalidateStats();
+  // reduces the moments of the rows not marked in skip, of every row if skip
+  // is null
+  Moments reduceMoments(const vector<bool>* skip) const;
+  // copies the numbers of the rows not marked in skip, of every row if skip
+  // is null
+  vector<double> gatherNumbers(const vector<bool>* skip) const;
+
+  // whether the column keeps a secondary index
+  bool indexed = false;
+  // whether the secondary index matches the values, moving rows around
+  // leaves it to be rebuilt by the next lookup
+  mutable bool indexValid = false;
+  // the secondary index of a string column, shared with the copies of the
+  // column until one of them changes it
+  mutable shared_ptr<StringIndex> stringIndex = make_shared<StringIndex>();
+  // the secondary index of a float column, shared the same way
+  mutable shared_ptr<NumberIndex> numberIndex = make_shared<NumberIndex>();
+  // rebuilds the secondary index if it does not match the values, and moves
+  // its rows by the inserts and deletes since the last lookup
+  void refreshIndex() const;
+  // copy the secondary index if it is shared before it is changed
+  StringIndex& editStringIndex();
+  NumberIndex& editNumberIndex();
+  // marks the secondary index as out of date
+  void invalidateIndex();
+  // adds the value at row to an up to date secondary index
+  void indexRow(size_t row);
+  // removes the value at row from an up to date secondary index
+  void unindexRow(size_t row);
+  // moves the rows of an up to date secondary index from row from on by
+  // delta on the next lookup, after a row was inserted or deleted before them
+  void shiftIndex(size_t from, ptrdiff_t delta);
 };
 
 /// @brief Class for the table that contains all the columns of the table
@@ -137,6 +497,72 @@ class Table {
   // the list of columns
   vector<Column> data;
 
+  // gathers the numbers of every float column into a single list
+  vector<double> getAllNumbers();
+
+  // merges the moments of every float column
+  Moments getTableMoments();
+
+  // gets the float columns of the table
+  vector<const Column*> getNumericalColumns() const;
+
+  // maps every header to the index of the first column with that header
+  unordered_map<string, size_t> headerIndex;
+  // the headers of the columns in order
+  vector<string> headers;
+  // counts the headers set on the columns of the table, a copy of the
+  // table starts a counter of its own and points its columns at it when its
+  // header index is rebuilt
+  struct HeaderCounter {
+    shared_ptr<atomic<size_t>> count = make_shared<atomic<size_t>>(0);
+    HeaderCounter() = default;
+    HeaderCounter(const HeaderCounter&) {}
+    HeaderCounter& operator=(const HeaderCounter&) { return *this; }
+  };
+  HeaderCounter headerCounter;
+  // the header generation the index was built at
+  size_t indexedGeneration = 0;
+  // checks if the header index was built from the current headers
+  bool isHeaderIndexCurrent() const;
+
+  // rebuilds the header index from the headers of the columns
+  void rebuildHeaderIndex();
+
+  // rebuilds the header index if a header was set since it was built
+  void refreshHeaderIndex();
+
+  // finds the index of the column with header header in constant time
+  // returns -1 if there is no such column
+  int findColumnIndex(const string& header);
+  // finds the index of the column with header header without rebuilding the
+  // index, in linear time if it is out of date
+  int findColumnIndex(const string& header) const;
+
+  // one flag per row, set for rows deleted since the last compaction, empty
+  // if no rows are pending deletion
+  vector<bool> deleted;
+  // the number of rows pending deletion
+  size_t deletedCount = 0;
+
+  // the cells of the last csv load that were not numbers
+  ParseReport parseReport;
+
+  // checks if the row at physical index row is pending deletion
+  bool isDeleted(size_t row) const {
+    return deletedCount != 0 && deleted[row];
+  }
+
+  // the streaming csv loader fills the columns and dimensions directly
+  friend class CsvReader;
+  // the snapshot reader and writer handle the storage directly
+  friend class Snapshot;
+  // and so does the conversion to and from arrow
+  friend class ArrowBridge;
+  // predicates look their columns up by header
+  friend class Predicate;
+  // views read the columns and the rows pending deletion
+  friend class TableView;
+
   // public members
  public:
   /// @brief constructor method that takes the number of columns and rows to
@@ -160,7 +586,7 @@ class Table {
   /// @brief checks if the column exists in the table
   /// @param header the header of the column to check
   /// @return true if it exists, false if it doesnt
-  bool columnExists(string header);
+  bool columnExists(const string& header);
 
   /// @brief subscript operator that returns a reference to the column at index
   /// i
@@ -168,25 +594,27 @@ class Table {
   /// @return the reference of the column
   Column& operator[](size_t i);
 
-  /// @brief overloaded subscript operator that returns the column at index i
+  /// @brief overloaded subscript operator that returns the column at index i,
+  /// rows pending deletion stay in the column until the table is compacted
   /// @param i the index of the column
-  /// @return the column at index i
-  Column operator[](const size_t i) const;
+  /// @return a read only reference to the column at index i
+  const Column& operator[](const size_t i) const;
 
   /// @brief gets the reference to the column by header
   /// @param header the header of the column to get
   /// @return the reference to the column
-  Column& getColumnByHeader(string header);
+  Column& getColumnByHeader(const string& header);
 
   /// @brief gets the value at column with header header and row index rowNo
   /// @param header the header of the column to query
   /// @param rowNo the row index to query
   /// @return the stirng to get
-  string getValueAt(string header, size_t rowNo);
+  string getValueAt(const string& header, size_t rowNo);
 
   /// @brief gets all column headers
-  /// @return a list of all the column headers
-  vector<string> getAllColumnHeaders();
+  /// @return a read only list of all the column headers, kept up to date by
+  /// the table instead of being rebuilt on every call
+  const vector<string>& getAllColumnHeaders();
 
   /// @brief displays the table in ASCII text format
   void displayTable() const;
@@ -195,10 +623,79 @@ class Table {
   /// @return list of lines of csv
   vector<string> to_csv();
 
+  /// @brief writes the table as csv to an output stream in batches of rows,
+  /// using the same amount of memory for tables of any size
+  /// @param out the stream to write to
+  void to_csv(ostream& out);
+
+  /// @brief writes the table as csv to a file descriptor in batches of rows
+  /// @param fd the file descriptor to write to
+  void to_csv(int fd);
+
   /// @brief populates the table with values parsed from csv
   /// @param csv 2D array of the parsed comma seperated values
   void from_csv(vector<vector<string>>& csv);
 
+  /// @brief populates the table by streaming the csv file at path, the file
+  /// is memory mapped where the platform supports it and read in chunks
+  /// otherwise
+  /// @param path the path of the csv file
+  void from_csv(const string& path);
+
+  /// @brief reads the csv file at path into the table with every thread of
+  /// the pool, the file is split into parts at the ends of records and the
+  /// parts are parsed at the same time, the result is the same as from_csv
+  /// @param path the path of the csv file
+  void from_csv_parallel(const string& path);
+
+  /// @brief populates the table by reading csv from a stream in chunks, so
+  /// the text never has to be held in memory as a whole
+  /// @param in the stream to read the csv from
+  void from_csv(istream& in);
+
+  /// @brief gets the cells of the last csv load that held a missing number
+  /// or text that is not a number, both are stored as NaN instead of failing
+  /// the load
+  /// @return the counts of the cells
+  const ParseReport& getParseReport() const;
+
+  /// @brief writes the table to a binary snapshot file holding the typed
+  /// buffers of every column
+  /// @param path the path of the snapshot file
+  void to_snapshot(const string& path);
+
+  /// @brief replaces the content of the table with a snapshot file, the file
+  /// is memory mapped and the columns read straight from the mapping, so
+  /// pages are only loaded once they are used
+  /// @param path the path of the snapshot file
+  void from_snapshot(const string& path);
+
+#ifdef TABLUZZY_ARROW
+  /// @brief writes the table to an arrow ipc file
+  /// @param path the path of the arrow file
+  /// @param stream whether to write the ipc stream format instead of the
+  /// file format
+  void to_arrow(const string& path, bool stream = false);
+
+  /// @brief replaces the content of the table with an arrow ipc file or
+  /// stream, the file is memory mapped and numbers, dictionary codes and
+  /// string bytes are read straight from the mapping
+  /// @param path the path of the arrow file
+  void from_arrow(const string& path);
+
+  /// @brief converts the table to an arrow table, numbers and dictionary
+  /// codes are shared instead of copied, the table copies the chunks it
+  /// shares before changing them, so the arrow table outlives the changes
+  /// and the table
+  /// @return the arrow table
+  shared_ptr<arrow::Table> to_arrow_table();
+
+  /// @brief replaces the content of the table with an arrow table, sharing
+  /// its buffers where the layouts match
+  /// @param table the arrow table
+  void from_arrow_table(const shared_ptr<arrow::Table>& table);
+#endif
+
   /// @brief gets the minimum value in the table
   /// @return minimum value in the table
   float getMinimumValue();
@@ -233,11 +730,11 @@ class Table {
 
   /// @brief  gets the number of rows of the table
   /// @return the number of rows in the table
-  int getNumberOfRows();
+  int getNumberOfRows() const;
 
   /// @brief gets the number of columns in the table
   /// @return the number of columns in the table
-  int getNumberOfColumns();
+  int getNumberOfColumns() const;
 
   /// @brief checks if the values can be inserted into the table
   /// @param values the values to check against the table
@@ -246,19 +743,58 @@ class Table {
 
   /// @brief deletes the column by its column header
   /// @param colHeader the column header of the column to be deleted
-  void deleteColumn(string& colHeader);
+  void deleteColumn(const string& colHeader);
 
   /// @brief inserts a list of values to the row index at rowIndex
   /// @param rawValues the list of values to be inserted
   /// @param rowIndex the row index of the row to insert the values in
-  void insertRowAtIndex(vector<string>& rawValues, size_t rowIndex);
+  void insertRowAtIndex(const vector<string>& rawValues, size_t rowIndex);
+
+  /// @brief inserts a list of values to the row index at rowIndex, the same
+  /// as the overload above as the values are copied into the columns
+  /// @param rawValues the list of values to be inserted
+  /// @param rowIndex the row index of the row to insert the values in
+  void insertRowAtIndex(vector<string>&& rawValues, size_t rowIndex);
 
   /// @brief converts the content of the table to html
   vector<string> to_html();
 
-  /// @brief sorts the table by the column with header colHeader
+  /// @brief writes the content of the table as html to an output stream in
+  /// batches of rows
+  /// @param out the stream to write to
+  void to_html(ostream& out);
+
+  /// @brief writes the content of the table as html to a file descriptor in
+  /// batches of rows
+  /// @param fd the file descriptor to write to
+  void to_html(int fd);
+
+  /// @brief sorts the table by the column with header colHeader, rows with
+  /// equal values keep their relative order
   /// @param colHeader the header of the column to be sorted
-  void sortTableByColumn(string& colHeader);
+  /// @param order the order to sort the rows in
+  /// @param parallel whether large tables should be sorted on several threads
+  void sortTableByColumn(const string& colHeader, SortOrder order = ascending,
+                         bool parallel = false);
+
+  /// @brief sorts the table by several columns, later keys break the ties of
+  /// earlier keys and rows that are equal on every key keep their order
+  /// @param keys the columns to sort by and the order of each of them
+  /// @param parallel whether large tables should be sorted on several threads
+  void sortTableByColumns(const vector<SortKey>& keys, bool parallel = false);
+
+  /// @brief computes the row order that sorts the table by keys without
+  /// moving any values
+  /// @param keys the columns to sort by and the order of each of them
+  /// @param parallel whether large tables should be sorted on several threads
+  /// @return the source row index of every row of the sorted table
+  vector<size_t> getSortPermutation(const vector<SortKey>& keys,
+                                    bool parallel = false);
+
+  /// @brief reorders every column so that row i holds the row that was at
+  /// permutation[i]
+  /// @param permutation the source row index of every row
+  void applyRowPermutation(const vector<size_t>& permutation);
 
   /// @brief swaps the row at rowIndex1 with the row at index rowIndex2
   /// @param rowIndex1 the index of the first row to be swapped
@@ -275,19 +811,114 @@ class Table {
   /// @param colHeader the header of the column
   /// @param value the value to find search for
   /// @return the index of the first occurrence
-  int getRowIndexOfFirstOccurrence(string& colHeader, string value);
+  int getRowIndexOfFirstOccurrence(const string& colHeader, string value);
 
   /// @brief gets row index of the first occurrence in the column with header
-  /// colHeader
+  /// colHeader, values are truncated to integers before they are compared so
+  /// 3 finds 3.7, and strings are compared by the integer they start with
   /// @param colHeader the header of the column to search in
   /// @param value the value to search for
   /// @return the index of the first element
-  int getRowIndexOfFirstOccurrence(string& colHeader, size_t value);
+  int getRowIndexOfFirstOccurrence(const string& colHeader, size_t value);
+
+  /// @brief gets the indexes of every row holding value in the column with
+  /// header colHeader
+  /// @param colHeader the header of the column to search in
+  /// @param value the value to search for
+  /// @return the indexes of the rows in ascending order
+  vector<size_t> getRowIndexesOfAllOccurrences(const string& colHeader,
+                                               const string& value);
+
+  /// @brief gets the indexes of every row of the float column with header
+  /// colHeader holding a value between low and high, both included
+  /// @param colHeader the header of the column to search in
+  /// @param low the smallest value to find
+  /// @param high the biggest value to find
+  /// @return the indexes of the rows in ascending order
+  vector<size_t> getRowIndexesInRange(const string& colHeader, double low,
+                                      double high);
+
+  /// @brief builds a secondary index over the column with header colHeader,
+  /// which speeds up every lookup in that column and is kept up to date by
+  /// the mutators
+  /// @param colHeader the header of the column to index
+  void createIndex(const string& colHeader);
+
+  /// @brief drops the secondary index of the column with header colHeader
+  /// @param colHeader the header of the column
+  void dropIndex(const string& colHeader);
 
   /// @brief delets the row at index rowIndex
   /// @param rowIndex the index of the row to be deleted
   void deleteRow(size_t rowIndex);
 
+  /// @brief marks a batch of rows as deleted without moving any values, the
+  /// rows are skipped by reads, statistics and exports and removed from the
+  /// columns in a single pass on the next compaction
+  /// @param rowIndexes the indexes of the rows to delete, indexes that repeat
+  /// or are out of range are ignored
+  /// @return the number of rows that were marked
+  size_t deleteRows(span<const size_t> rowIndexes);
+
+  /// @brief marks every row the predicate holds for as deleted, see deleteRows
+  /// @param predicate called with the index of every row
+  /// @return the number of rows that were marked
+  size_t deleteRowsWhere(const function<bool(size_t)>& predicate);
+
+  /// @brief removes the rows marked as deleted from every column in a single
+  /// pass, called before any operation that works on row positions
+  void compact();
+
+  /// @brief gets the number of rows marked as deleted but not compacted yet
+  /// @return the number of rows pending deletion
+  size_t getNumberOfDeletedRows() const;
+
+  /// @brief gets the rows that match a predicate, evaluating it a column at
+  /// a time
+  /// @param predicate the condition the rows have to meet
+  /// @return the indexes of the rows in ascending order
+  vector<size_t> filterRows(const Predicate& predicate);
+
+  /// @brief builds a new table from the rows that match a predicate
+  /// @param predicate the condition the rows have to meet
+  /// @return a table with the same columns holding copies of the rows
+  Table filter(const Predicate& predicate);
+
+  /// @brief groups the rows by the values of key columns and aggregates the
+  /// float columns of every group, hashing the rows on every thread
+  /// @param keys the headers of the columns to group by
+  /// @param values the headers of the float columns to aggregate, every float
+  /// column that is not a key if empty
+  /// @return a table with a row per group in the order the groups first
+  /// appear, holding the keys, the number of rows of the group as count and
+  /// the sum, min, max, mean and variance of every value column as
+  /// <header>_sum, <header>_min and so on, a header already taken is
+  /// followed by 2, 3 and so on
+  Table groupBy(const vector<string>& keys,
+                const vector<string>& values = {});
+
+  /// @brief joins the rows of this table to the rows of other holding the
+  /// same key, hashing the keys of the smaller table and probing them with
+  /// the keys of the bigger one on every thread, missing numbers never match
+  /// @param other the right table of the join
+  /// @param key the header of the key column of this table
+  /// @param otherKey the header of the key column of other
+  /// @param type the rows the join keeps
+  /// @return a table with the columns of this table followed by the columns
+  /// of other but its key, headers already taken get the suffix _right,
+  /// followed by 2, 3 and so on if that is taken too, and a row per pair of
+  /// matching rows in the order of this table and then of other
+  Table join(Table& other, const string& key, const string& otherKey,
+             JoinType type = innerJoin);
+
+  /// @brief joins the rows of this table to the rows of other holding the
+  /// same key in a column with the same header
+  /// @param other the right table of the join
+  /// @param key the header of the key column of both tables
+  /// @param type the rows the join keeps
+  /// @return the joined table
+  Table join(Table& other, const string& key, JoinType type = innerJoin);
+
   /// @brief flushes all the previous values of the table
   void flushTable();
 };
@@ -0,0 +1,157 @@
+#ifndef TABLUZZY_VIEW_HPP
+#define TABLUZZY_VIEW_HPP
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+class BufferedWriter;
+class Column;
+class Predicate;
+class Table;
+struct ColumnStats;
+struct SortKey;
+
+/// @brief Class for a read only view of some columns and rows of a table,
+/// in any order, that never copies a value of the table. Views are built
+/// from other views, so the steps of a pipeline only ever copy row indexes.
+/// A view is valid until its table is changed
+class TableView {
+ public:
+  /// @brief constructor method for a view of every column and of every row
+  /// of table that is not pending deletion
+  /// @param table the table to view
+  TableView(const Table& table);
+
+  /// @brief gets the number of rows in the view
+  /// @return the number of rows
+  size_t getNumberOfRows() const { return count; }
+
+  /// @brief gets the number of columns in the view
+  /// @return the number of columns
+  size_t getNumberOfColumns() const { return columnIndexes.size(); }
+
+  /// @brief gets a column of the table by its position in the view
+  /// @param x the position of the column in the view
+  /// @return the column of the table
+  const Column& getColumn(size_t x) const;
+
+  /// @brief gets the index in the table of a row of the view
+  /// @param row the position of the row in the view
+  /// @return the index of the row in the table
+  size_t getRowIndex(size_t row) const {
+    return rowIndexes ? (*rowIndexes)[first + row] : first + row;
+  }
+
+  /// @brief gets the text of a value of the view
+  /// @param header the header of the column
+  /// @param row the position of the row in the view
+  /// @return the text of the value
+  string getValueAt(const string& header, size_t row) const;
+
+  /// @brief views some of the columns of this view
+  /// @param headers the headers of the columns, in the order to view them in
+  /// @return the view of the columns
+  TableView select(const vector<string>& headers) const;
+
+  /// @brief views a range of the rows of this view, the range is cut off at
+  /// the last row
+  /// @param first the position of the first row of the range
+  /// @param rowCount the number of rows in the range
+  /// @return the view of the rows
+  TableView slice(size_t first, size_t rowCount) const;
+
+  /// @brief views rows of this view in a given order, a permutation of the
+  /// rows reorders the view and fewer rows select some of them
+  /// @param rows the positions of the rows in this view
+  /// @return the view of the rows
+  TableView withRows(const vector<size_t>& rows) const;
+
+  /// @brief views the rows of this view that match a predicate
+  /// @param predicate the condition the rows have to meet
+  /// @return the view of the rows in the same order
+  TableView where(const Predicate& predicate) const;
+
+  /// @brief views the rows of this view sorted by some of the columns of the
+  /// table, rows with equal keys keep their order
+  /// @param keys the keys to sort by, the first key that differs decides
+  /// @return the view of the sorted rows
+  TableView sortedBy(const vector<SortKey>& keys) const;
+
+  /// @brief displays the view in ASCII text format
+  void displayTable() const;
+
+  /// @brief converts the view to csv
+  /// @return list of lines of csv
+  vector<string> to_csv() const;
+
+  /// @brief writes the view as csv to an output stream in batches of rows
+  /// @param out the stream to write to
+  void to_csv(ostream& out) const;
+
+  /// @brief writes the view as csv to a file descriptor in batches of rows
+  /// @param fd the file descriptor to write to
+  void to_csv(int fd) const;
+
+  /// @brief converts the view to html
+  /// @return list of html tags
+  vector<string> to_html() const;
+
+  /// @brief writes the view as html to an output stream in batches of rows
+  /// @param out the stream to write to
+  void to_html(ostream& out) const;
+
+  /// @brief writes the view as html to a file descriptor in batches of rows
+  /// @param fd the file descriptor to write to
+  void to_html(int fd) const;
+
+  /// @brief gets the statistics of the numbers of a float column over the
+  /// rows of the view, the row index x of the regression counts the rows of
+  /// the view
+  /// @param header the header of the column
+  /// @return the statistics of the column
+  ColumnStats getStats(const string& header) const;
+
+  /// @brief displays a report of the statistics of every float column of the
+  /// view
+  void displayReport() const;
+
+ private:
+  // the viewed table
+  const Table* table;
+  // the indexes in the table of the viewed columns
+  vector<size_t> columnIndexes;
+  // the indexes in the table of the viewed rows, null if the viewed rows are
+  // the rows of the table from first on, shared by the views built from this
+  // one
+  shared_ptr<const vector<size_t>> rowIndexes;
+  // the first viewed entry of rowIndexes, or row of the table
+  size_t first = 0;
+  // the number of viewed rows
+  size_t count = 0;
+
+  // finds the position in the view of the column with header header, -1 if
+  // there is none
+  int findColumn(const string& header) const;
+  // checks if the view holds every row of the table, in order
+  bool viewsEveryRow() const;
+  // a view of the same columns holding the rows at indexes in the table
+  TableView withRowIndexes(vector<size_t> indexes) const;
+  // gets the statistics of a float column of the table over the viewed rows
+  ColumnStats getStats(const Column& col) const;
+
+  // gets the four lines of the csv header block
+  vector<string> getCsvHeaderLines() const;
+  // appends the csv line of a row, without the line break
+  void appendCsvRow(size_t row, string& line) const;
+  // appends the html cell of the column at position x of a row
+  void appendHtmlCell(size_t row, size_t x, string& html) const;
+  // write the view as csv or html through a buffered writer
+  void writeCsv(BufferedWriter& writer) const;
+  void writeHtml(BufferedWriter& writer) const;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef TABLUZZY_WRITER_HPP
+#define TABLUZZY_WRITER_HPP
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+using namespace std;
+
+/// @brief Class that collects text in a fixed size buffer and hands it to an
+/// output stream or a file descriptor in large batches, so writing a table
+/// of any size takes the same amount of memory
+class BufferedWriter {
+ public:
+  // the number of bytes collected before they are written out
+  static constexpr size_t BUFFER_SIZE = 1 << 16;
+
+  /// @brief constructor method for a writer to an output stream
+  /// @param out the stream to write to
+  BufferedWriter(ostream& out);
+
+  /// @brief constructor method for a writer to a file descriptor
+  /// @param fd the file descriptor to write to
+  BufferedWriter(int fd);
+
+  // destructor method, writes out what is left in the buffer
+  ~BufferedWriter();
+
+  BufferedWriter(const BufferedWriter&) = delete;
+  BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+  /// @brief adds text to the buffer
+  /// @param text the text to add
+  void write(string_view text) { buffer.append(text); }
+
+  /// @brief adds a single character to the buffer
+  /// @param c the character to add
+  void put(char c) { buffer.push_back(c); }
+
+  /// @brief gets the buffer so text can be formatted straight into it
+  /// @return the buffer
+  string& getBuffer() { return buffer; }
+
+  /// @brief marks the end of a record, the buffer is written out once it is
+  /// full so records are only ever split between batches
+  void endRecord() {
+    if (buffer.size() >= BUFFER_SIZE) flush();
+  }
+
+  /// @brief writes out everything in the buffer
+  void flush();
+
+ private:
+  // the stream to write to, or nullptr if writing to a file descriptor
+  ostream* out = nullptr;
+  // the file descriptor to write to
+  int fd = -1;
+  // the text collected so far
+  string buffer;
+};
+
+#endif
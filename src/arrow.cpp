@@ -0,0 +1,338 @@
+#ifdef TABLUZZY_ARROW
+
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <arrow/ipc/api.h>
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "tabluzzy.hpp"
+
+using namespace std;
+
+// the first bytes of an arrow ipc file, streams start without them
+static const char ARROW_FILE_MAGIC[6] = {'A', 'R', 'R', 'O', 'W', '1'};
+
+// turns a failed arrow status into an exception
+static void check(const arrow::Status& status) {
+  if (!status.ok()) throw runtime_error("arrow: " + status.ToString());
+}
+
+// gets the value of an arrow result, turning a failure into an exception
+template <typename T>
+static T unwrap(arrow::Result<T> result) {
+  check(result.status());
+  return result.MoveValueUnsafe();
+}
+
+// an arrow buffer over the values of a chunk, holding the owner of the chunk
+// for as long as arrow uses the buffer
+class ChunkBuffer : public arrow::Buffer {
+ public:
+  template <typename T>
+  ChunkBuffer(span<const T> values, shared_ptr<const void> owner)
+      : arrow::Buffer(reinterpret_cast<const uint8_t*>(values.data()),
+                      values.size_bytes()),
+        owner(move(owner)) {}
+
+ private:
+  shared_ptr<const void> owner;
+};
+
+/// @brief Class converting tables to and from arrow tables, a friend of both
+/// Table and Column so buffers can be shared instead of copied
+class ArrowBridge {
+ public:
+  /// @brief converts table to an arrow table, numbers and dictionary codes
+  /// are shared with the table and strings are copied, the arrow buffers
+  /// hold the chunks they share so the table copies them before changing
+  /// them
+  static shared_ptr<arrow::Table> exportTable(Table& table) {
+    // rows pending deletion are not exported
+    table.compact();
+    arrow::FieldVector fields;
+    vector<shared_ptr<arrow::ChunkedArray>> columns;
+    for (const Column& col : table.data) {
+      shared_ptr<arrow::ChunkedArray> column = exportColumn(col);
+      fields.push_back(arrow::field(col.getHeader(), column->type()));
+      columns.push_back(move(column));
+    }
+    return arrow::Table::Make(arrow::schema(fields), columns, table.rows);
+  }
+
+  /// @brief replaces the content of table with an arrow table, numbers
+  /// without nulls, dictionary codes and string bytes are borrowed from the
+  /// arrow buffers
+  static void importTable(Table& table,
+                          const shared_ptr<arrow::Table>& source) {
+    table.flushTable();
+    for (int x = 0; x < source->num_columns(); x++) {
+      const shared_ptr<arrow::ChunkedArray>& column = source->column(x);
+      arrow::Type::type id = column->type()->id();
+      bool text = id == arrow::Type::STRING ||
+                  id == arrow::Type::LARGE_STRING ||
+                  id == arrow::Type::DICTIONARY;
+      table.addColumn(source->schema()->field(x)->name(),
+                      text ? ValueType::str : ValueType::flt);
+      Column& col = table.data.back();
+      for (const shared_ptr<arrow::Array>& chunk : column->chunks()) {
+        importChunk(col, chunk);
+      }
+    }
+    table.rows = source->num_rows();
+  }
+
+ private:
+  // converts a column to a chunked arrow array, one arrow chunk per chunk
+  static shared_ptr<arrow::ChunkedArray> exportColumn(const Column& col) {
+    arrow::ArrayVector chunks;
+    if (col.type == ValueType::flt) {
+      // the numbers are wrapped without copying them
+      for (size_t c = 0; c < col.numbers.getChunkCount(); c++) {
+        span<const double> chunk = col.numbers.getChunk(c);
+        chunks.push_back(make_shared<arrow::DoubleArray>(
+            chunk.size(), make_shared<ChunkBuffer>(
+                              chunk, col.numbers.getChunkOwner(c))));
+      }
+      return make_shared<arrow::ChunkedArray>(chunks, arrow::float64());
+    }
+    if (col.encoded) {
+      // the dictionary is built once and shared by every chunk, whose codes
+      // are wrapped without copying them
+      arrow::StringBuilder builder;
+      for (size_t code = 0; code < col.dictionary->size(); code++) {
+        check(builder.Append(col.dictionary->decode(code)));
+      }
+      shared_ptr<arrow::Array> dictionary;
+      check(builder.Finish(&dictionary));
+      auto type = arrow::dictionary(arrow::int32(), arrow::utf8());
+      for (size_t c = 0; c < col.codes.getChunkCount(); c++) {
+        span<const uint32_t> chunk = col.codes.getChunk(c);
+        auto indices = make_shared<arrow::Int32Array>(
+            chunk.size(),
+            make_shared<ChunkBuffer>(chunk, col.codes.getChunkOwner(c)));
+        chunks.push_back(
+            make_shared<arrow::DictionaryArray>(type, indices, dictionary));
+      }
+      return make_shared<arrow::ChunkedArray>(chunks, type);
+    }
+    // plain strings are copied into offsets and bytes, chunk by chunk
+    col.rows.forEachChunk([&](span<const StrRef> chunk) {
+      arrow::StringBuilder builder;
+      size_t bytes = 0;
+      for (const StrRef& ref : chunk) bytes += ref.length;
+      check(builder.Reserve(chunk.size()));
+      check(builder.ReserveData(bytes));
+      for (const StrRef& ref : chunk) {
+        builder.UnsafeAppend(col.arena.view(ref));
+      }
+      shared_ptr<arrow::Array> array;
+      check(builder.Finish(&array));
+      chunks.push_back(move(array));
+    });
+    return make_shared<arrow::ChunkedArray>(chunks, arrow::utf8());
+  }
+
+  // appends the numbers of a numerical arrow array, nulls become NaN
+  template <typename ArrayType>
+  static void importNumbers(Column& col, const arrow::Array& chunk) {
+    const ArrayType& array = static_cast<const ArrayType&>(chunk);
+    for (int64_t i = 0; i < array.length(); i++) {
+      col.numbers.push_back(array.IsNull(i)
+                                ? numeric_limits<double>::quiet_NaN()
+                                : static_cast<double>(array.Value(i)));
+    }
+  }
+
+  // appends the strings of an arrow string array, borrowing its bytes
+  template <typename ArrayType>
+  static void importStrings(Column& col,
+                            const shared_ptr<arrow::Array>& chunk) {
+    const ArrayType& array = static_cast<const ArrayType&>(*chunk);
+    auto offsets = array.raw_value_offsets();
+    const shared_ptr<arrow::Buffer>& data = array.value_data();
+    size_t size = data ? data->size() : 0;
+    // the bytes become a block of the arena if offsets into them fit
+    if (size > numeric_limits<uint32_t>::max()) {
+      for (int64_t i = 0; i < array.length(); i++) {
+        col.rows.push_back(col.arena.store(array.GetView(i)));
+      }
+      return;
+    }
+    uint32_t block = col.arena.addBorrowedBlock(
+        string_view(data ? reinterpret_cast<const char*>(data->data()) : "",
+                    size),
+        chunk);
+    for (int64_t i = 0; i < array.length(); i++) {
+      StrRef ref;
+      // nulls become empty strings
+      if (!array.IsNull(i)) {
+        ref.block = block;
+        ref.offset = offsets[i];
+        ref.length = offsets[i + 1] - offsets[i];
+      }
+      col.rows.push_back(ref);
+    }
+  }
+
+  // appends the values of an arrow dictionary array to an encoded column
+  static void importDictionary(Column& col,
+                               const shared_ptr<arrow::Array>& chunk) {
+    const auto& array = static_cast<const arrow::DictionaryArray&>(*chunk);
+    const shared_ptr<arrow::Array>& values = array.dictionary();
+    arrow::Type::type valueId = values->type_id();
+    if (valueId != arrow::Type::STRING &&
+        valueId != arrow::Type::LARGE_STRING) {
+      throw runtime_error("arrow: unsupported dictionary value type " +
+                          values->type()->ToString());
+    }
+    if (!col.encoded) {
+      col.dictionary = make_shared<Dictionary>();
+      col.encoded = true;
+    }
+    // every arrow code is mapped to the code of its value in the column
+    vector<uint32_t> remap(values->length());
+    bool identity = true;
+    for (int64_t v = 0; v < values->length(); v++) {
+      string_view value =
+          (valueId == arrow::Type::STRING)
+              ? static_cast<const arrow::StringArray&>(*values).GetView(v)
+              : static_cast<const arrow::LargeStringArray&>(*values).GetView(
+                    v);
+      remap[v] = col.dictionary->encode(value);
+      identity = identity && remap[v] == v;
+    }
+    const shared_ptr<arrow::Array>& indices = array.indices();
+    bool borrowable = identity && indices->null_count() == 0 &&
+                      (indices->type_id() == arrow::Type::INT32 ||
+                       indices->type_id() == arrow::Type::UINT32);
+    if (borrowable) {
+      // codes that need no mapping are borrowed as they are
+      auto raw = reinterpret_cast<const uint32_t*>(
+          indices->data()->GetValues<int32_t>(1));
+      col.codes.appendBorrowed(span<const uint32_t>(raw, indices->length()),
+                               chunk);
+      return;
+    }
+    // otherwise they are mapped one by one, nulls become empty strings
+    uint32_t empty = col.dictionary->encode("");
+    for (int64_t i = 0; i < array.length(); i++) {
+      col.codes.push_back(array.IsNull(i) ? empty
+                                          : remap[array.GetValueIndex(i)]);
+    }
+  }
+
+  // appends the rows of an arrow array to a column
+  static void importChunk(Column& col, const shared_ptr<arrow::Array>& chunk) {
+    switch (chunk->type_id()) {
+      case arrow::Type::DOUBLE:
+        // numbers without nulls are borrowed from the arrow buffer
+        if (chunk->null_count() == 0) {
+          const auto& array = static_cast<const arrow::DoubleArray&>(*chunk);
+          col.numbers.appendBorrowed(
+              span<const double>(array.raw_values(), array.length()), chunk);
+        } else {
+          importNumbers<arrow::DoubleArray>(col, *chunk);
+        }
+        break;
+      case arrow::Type::FLOAT:
+        importNumbers<arrow::FloatArray>(col, *chunk);
+        break;
+      case arrow::Type::INT8:
+        importNumbers<arrow::Int8Array>(col, *chunk);
+        break;
+      case arrow::Type::INT16:
+        importNumbers<arrow::Int16Array>(col, *chunk);
+        break;
+      case arrow::Type::INT32:
+        importNumbers<arrow::Int32Array>(col, *chunk);
+        break;
+      case arrow::Type::INT64:
+        importNumbers<arrow::Int64Array>(col, *chunk);
+        break;
+      case arrow::Type::UINT8:
+        importNumbers<arrow::UInt8Array>(col, *chunk);
+        break;
+      case arrow::Type::UINT16:
+        importNumbers<arrow::UInt16Array>(col, *chunk);
+        break;
+      case arrow::Type::UINT32:
+        importNumbers<arrow::UInt32Array>(col, *chunk);
+        break;
+      case arrow::Type::UINT64:
+        importNumbers<arrow::UInt64Array>(col, *chunk);
+        break;
+      case arrow::Type::BOOL:
+        importNumbers<arrow::BooleanArray>(col, *chunk);
+        break;
+      case arrow::Type::STRING:
+        importStrings<arrow::StringArray>(col, chunk);
+        break;
+      case arrow::Type::LARGE_STRING:
+        importStrings<arrow::LargeStringArray>(col, chunk);
+        break;
+      case arrow::Type::DICTIONARY:
+        importDictionary(col, chunk);
+        break;
+      default:
+        throw runtime_error("arrow: unsupported column type " +
+                            chunk->type()->ToString());
+    }
+  }
+};
+
+shared_ptr<arrow::Table> Table::to_arrow_table() {
+  // the bridge reads the storage of the columns directly
+  return ArrowBridge::exportTable(*this);
+}
+
+void Table::from_arrow_table(const shared_ptr<arrow::Table>& table) {
+  // the bridge points the columns at the arrow buffers where it can
+  ArrowBridge::importTable(*this, table);
+}
+
+void Table::to_arrow(const string& path, bool stream) {
+  shared_ptr<arrow::Table> table = to_arrow_table();
+  auto sink = unwrap(arrow::io::FileOutputStream::Open(path));
+  // the file format can be read at random, the stream format in one pass
+  shared_ptr<arrow::ipc::RecordBatchWriter> writer =
+      stream ? unwrap(arrow::ipc::MakeStreamWriter(sink, table->schema()))
+             : unwrap(arrow::ipc::MakeFileWriter(sink, table->schema()));
+  check(writer->WriteTable(*table));
+  check(writer->Close());
+  check(sink->Close());
+}
+
+void Table::from_arrow(const string& path) {
+  // the file is memory mapped so the buffers can be borrowed from it
+  auto file = unwrap(
+      arrow::io::MemoryMappedFile::Open(path, arrow::io::FileMode::READ));
+  // files start with a magic string, streams start with a message
+  shared_ptr<arrow::Buffer> magic = unwrap(file->ReadAt(0, 6));
+  bool isFile = magic->size() == 6 &&
+                memcmp(magic->data(), ARROW_FILE_MAGIC, 6) == 0;
+  arrow::RecordBatchVector batches;
+  shared_ptr<arrow::Schema> schema;
+  if (isFile) {
+    auto reader = unwrap(arrow::ipc::RecordBatchFileReader::Open(file));
+    schema = reader->schema();
+    for (int i = 0; i < reader->num_record_batches(); i++) {
+      batches.push_back(unwrap(reader->ReadRecordBatch(i)));
+    }
+  } else {
+    check(file->Seek(0));
+    auto reader = unwrap(arrow::ipc::RecordBatchStreamReader::Open(file));
+    schema = reader->schema();
+    while (true) {
+      shared_ptr<arrow::RecordBatch> batch;
+      check(reader->ReadNext(&batch));
+      if (!batch) break;
+      batches.push_back(move(batch));
+    }
+  }
+  from_arrow_table(unwrap(arrow::Table::FromRecordBatches(schema, batches)));
+}
+
+#endif
@@ -1,13 +1,37 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <iomanip>
 #include <iostream>
 #include <statsi/statsi.hpp>  // library of statistical functions to be used in program written by Mubarak
 #include <strfmt/strfmt.hpp>  // library of simple generic functions Mustafa and Azi wrote to be used in the main program. Source code found at libs/strfmt
 #include <string>
+#include <unordered_set>
 #include <terminalcancer/terminalcancer.hpp>  // library of simple terminal helper functions to be used in program written by Mustafa
 
+#include "parallel.hpp"
 #include "tabluzzy.hpp"
 using namespace std;
 
+// the number of rows a column is split into for the parallel statistics
+static const size_t PARALLEL_CHUNK = 1 << 16;
+
+// an automatically encoded column is checked every time this many rows were
+// appended
+static const size_t ENCODING_CHECK_ROWS = ChunkedVector<uint32_t>::CHUNK_SIZE;
+
+// a secondary index waiting for more moves and new rows than this is rebuilt
+// by the next lookup instead
+static const size_t MAX_PENDING_INDEX_EDITS = 256;
+
+// converts the text of a cell to the number stored in a float column, text
+// that is not a number is stored as a missing number (NaN)
+static double toNumber(string_view text) {
+  double value;
+  parseNumber(text, value);
+  return value;
+}
+
 // Column class constructor
 // neads a column header and a value type to be constructed
 Column::Column(string h, ValueType t) {
@@ -21,21 +45,199 @@ Column::~Column(){
 
 };
 
-string& Column::operator[](size_t rowNo) {
+string Column::operator[](size_t rowNo) const {
   // returns the value at that row number
-  return rows[rowNo];
+  return getValueAt(rowNo);
+};
+
+void Column::setValueAt(size_t rowNo, const string& value) {
+  invalidateStats();
+  unindexRow(rowNo);
+  // float columns keep the parsed number, string columns keep the text
+  if (type == ValueType::flt) {
+    numbers[rowNo] = toNumber(value);
+  } else if (encoded) {
+    codes[rowNo] = encodeValue(value);
+  } else {
+    // the bytes of the old string stay in the arena until it is repacked
+    const ChunkedVector<StrRef>& refs = rows;
+    arena.release(refs[rowNo]);
+    rows[rowNo] = arena.store(value);
+    reclaimStrings();
+  }
+  indexRow(rowNo);
+};
+
+void Column::setValueAt(size_t rowNo, string&& value) {
+  // the text is copied into the storage either way
+  setValueAt(rowNo, static_cast<const string&>(value));
+};
+
+void Column::setNumberAt(size_t rowNo, double value) {
+  invalidateStats();
+  unindexRow(rowNo);
+  // sets the number at row number to the value passed
+  numbers[rowNo] = value;
+  indexRow(rowNo);
+};
+
+void Column::pushValue(const string& value) {
+  invalidateStats();
+  // add a value to a new row in columns, parsing it once if it is numerical
+  if (type == ValueType::flt) {
+    numbers.push_back(toNumber(value));
+  } else if (encoded) {
+    codes.push_back(encodeValue(value));
+  } else {
+    rows.push_back(arena.store(value));
+  }
+  indexRow(getNumberOfRows() - 1);
+  checkEncoding();
 };
 
-void Column::setValueAt(size_t rowNo, string value) {
-  // sets the value at row number to the value passed
-  rows[rowNo] = value;
+void Column::pushValue(string&& value) {
+  // the text is copied into the storage either way
+  pushValue(static_cast<const string&>(value));
 };
 
-void Column::pushValue(string value) {
-  // add a value to a new row in columns
-  rows.push_back(value);
+void Column::pushString(string_view value) {
+  invalidateStats();
+  // the text is copied straight into the arena or the dictionary
+  if (encoded) {
+    codes.push_back(encodeValue(value));
+  } else {
+    rows.push_back(arena.store(value));
+  }
+  indexRow(getNumberOfRows() - 1);
+  checkEncoding();
+};
+
+void Column::appendRows(Column& other, size_t count) {
+  invalidateStats();
+  // the rows are added in bulk, so the index is rebuilt when it is next used
+  invalidateIndex();
+  // copies the first count values of a chunked vector through visit
+  auto forEachValue = [&](const auto& values, auto&& visit) {
+    size_t left = count;
+    values.forEachChunk([&](auto chunk) {
+      auto taken = chunk.first(min(left, chunk.size()));
+      left -= taken.size();
+      visit(taken);
+    });
+  };
+  if (type == ValueType::flt && other.type == ValueType::flt) {
+    // numbers are copied a chunk at a time
+    forEachValue(other.numbers, [&](span<const double> values) {
+      numbers.append(values);
+    });
+  } else if (type == ValueType::flt || other.type == ValueType::flt) {
+    // a column of another datatype is converted value by value
+    for (size_t y = 0; y < count; y++) pushValue(other.getValueAt(y));
+  } else if (encoded && other.encoded) {
+    // the codes of other are translated to codes of this dictionary, once
+    // for every distinct value
+    vector<uint32_t> translation(other.dictionary->size());
+    for (size_t code = 0; code < translation.size(); code++) {
+      translation[code] = encodeValue(other.dictionary->decode(code));
+    }
+    forEachValue(other.codes, [&](span<const uint32_t> values) {
+      for (uint32_t code : values) codes.push_back(translation[code]);
+    });
+    // a column that stopped repeating its values is stored plainly
+    if (encodedAutomatically && dictionary->size() * 2 > codes.size()) {
+      setStringEncoding(plainEncoding);
+      encodedAutomatically = true;
+    }
+  } else if (!encoded && !other.encoded) {
+    // the blocks of other become blocks of this arena, so only the
+    // locations are copied
+    uint32_t shift = arena.splice(other.arena);
+    forEachValue(other.rows, [&](span<const StrRef> values) {
+      for (StrRef ref : values) {
+        ref.block += shift;
+        rows.push_back(ref);
+      }
+    });
+  } else {
+    // columns encoded differently are joined string by string
+    for (size_t y = 0; y < count; y++) pushString(other.getStringAt(y));
+  }
+  // other gives up its rows
+  other.numbers.clear();
+  other.rows.clear();
+  other.arena.clear();
+  other.codes.clear();
+  if (other.encoded) other.dictionary = make_shared<Dictionary>();
+  other.invalidateStats();
+  other.invalidateIndex();
 };
-void Column::displayColumn() {
+
+void Column::appendRowsAt(const Column& other,
+                          span<const size_t> rowIndexes) {
+  invalidateStats();
+  invalidateIndex();
+  if (type == ValueType::flt && other.type == ValueType::flt) {
+    for (size_t row : rowIndexes) {
+      numbers.push_back(row == MISSING_ROW
+                            ? numeric_limits<double>::quiet_NaN()
+                            : other.numbers[row]);
+    }
+  } else if (encoded && other.type == ValueType::str && other.encoded) {
+    // the codes of other are translated the first time they are met, so
+    // every distinct value is hashed once, missing values are empty strings
+    vector<uint32_t> translation(other.dictionary->size() + 1, UINT32_MAX);
+    for (size_t row : rowIndexes) {
+      bool missing = (row == MISSING_ROW);
+      uint32_t& code =
+          translation[missing ? other.dictionary->size() : other.codes[row]];
+      if (code == UINT32_MAX) {
+        code = encodeValue(
+            missing ? "" : other.dictionary->decode(other.codes[row]));
+      }
+      codes.push_back(code);
+    }
+    // a column that stopped repeating its values is stored plainly
+    if (encodedAutomatically && dictionary->size() * 2 > codes.size()) {
+      setStringEncoding(plainEncoding);
+      encodedAutomatically = true;
+    }
+  } else if (type == ValueType::str && other.type == ValueType::str) {
+    for (size_t row : rowIndexes) {
+      pushString(row == MISSING_ROW ? "" : other.getStringAt(row));
+    }
+  } else {
+    // a column of another datatype is converted value by value
+    for (size_t row : rowIndexes) {
+      pushValue(row == MISSING_ROW ? "" : other.getValueAt(row));
+    }
+  }
+};
+
+void Column::pushNumber(double value) {
+  invalidateStats();
+  // add a number to a new row in the column
+  numbers.push_back(value);
+  indexRow(numbers.size() - 1);
+};
+
+void Column::reserve(size_t rowCount) {
+  // only the storage matching the datatype is ever filled
+  if (type == ValueType::flt) {
+    numbers.reserve(rowCount);
+  } else if (encoded) {
+    codes.reserve(rowCount);
+  } else {
+    rows.reserve(rowCount);
+  }
+};
+
+size_t Column::getNumberOfRows() const {
+  // returns the number of values held by the storage of the column
+  if (type == ValueType::flt) return numbers.size();
+  return encoded ? codes.size() : rows.size();
+};
+void Column::displayColumn() const {
+  TABLUZZY_TIME(displayTimer);
   // responsible for displaying the data in the column
 
   // gets the terminal dimensions for the current terminal
@@ -53,20 +255,20 @@ void Column::displayColumn() {
        << clearfmt << " |" << endl;
 
   // for every row in rows
-  for (int y = 0; y < rows.size(); y++) {
+  for (int y = 0; y < getNumberOfRows(); y++) {
     cout << "|";
 
     // if the value type is float
     if (type == ValueType::flt) {
       // we set the precision for the value to 0
       cout << setw(8) << setfill(' ') << setprecision(0) << left << fixed
-           << stof(rows[y]) << "\t"
+           << numbers[y] << "\t"
            << "|";
 
     } else if (type == ValueType::str) {
       // if the value is of type string
       cout << setw(8) << setfill(' ') << setprecision(0) << left << fixed
-           << rows[y] << "\t"
+           << getStringAt(y) << "\t"
            << "|";
     }
 
@@ -77,22 +279,73 @@ void Column::displayColumn() {
        << "+" << endl;
 };
 
-string Column::getHeader() {
+const string& Column::getHeader() const {
   // returns the header for that column
   return header;
 };
 
-string Column::getValueAt(size_t rowNo) {
+string Column::getValueAt(size_t rowNo) const {
+  // numbers are only turned back into text when they are asked for as text
+  if (type == ValueType::flt) return formatNumber(numbers[rowNo]);
   // returns the value at row number
-  return rows[rowNo];
+  return string(getStringAt(rowNo));
+}
+
+void Column::appendValueAt(size_t rowNo, string& out) const {
+  // numbers are formatted on the stack and strings appended from a view
+  if (type == ValueType::flt) {
+    char buffer[NUMBER_BUFFER_SIZE];
+    out.append(buffer, formatNumber(numbers[rowNo], buffer));
+  } else {
+    out.append(getStringAt(rowNo));
+  }
+}
+
+double Column::getNumberAt(size_t rowNo) const {
+  // returns the number at row number
+  return numbers[rowNo];
+}
+
+string_view Column::getStringAt(size_t rowNo) const {
+  // returns a view of the string at row number
+  if (encoded) return dictionary->decode(codes[rowNo]);
+  return arena.view(rows[rowNo]);
 }
 
 void Column::setValueType(ValueType dttype) {
+  invalidateStats();
+  // if the type does not change the storage stays as it is
+  if (dttype == type) return;
+  // the index changes kind with the column
+  invalidateIndex();
+
+  if (dttype == ValueType::flt) {
+    // we parse every string into the numerical storage
+    size_t count = getNumberOfRows();
+    numbers.reserve(count);
+    for (size_t y = 0; y < count; y++) {
+      numbers.push_back(toNumber(getStringAt(y)));
+    }
+    rows.clear();
+    arena.clear();
+    codes.clear();
+    dictionary.reset();
+    encoded = encodedAutomatically = false;
+  } else {
+    // we format every number into the string storage
+    rows.reserve(numbers.size());
+    numbers.forEachChunk([this](span<const double> block) {
+      for (double number : block) {
+        rows.push_back(arena.store(formatNumber(number)));
+      }
+    });
+    numbers.clear();
+  }
   // sets the return type of the current table
   type = dttype;
 };
 
-int Column::getIndex() {
+int Column::getIndex() const {
   // returns the index of the column
   return index;
 };
@@ -100,97 +353,680 @@ int Column::getIndex() {
 void Column::setHeader(string h) {
   // sets the header property to h
   header = h;
+  // and lets the table know its header index has to be checked
+  if (headerGeneration) (*headerGeneration)++;
 };
 void Column::setIndex(size_t i) {
   // sets the index of column to index i
   index = i;
 };
 
-ValueType Column::getValueType() {
+ValueType Column::getValueType() const {
   // gets the value type of the column
   return type;
 };
 
-float Column::getMinimumValue() {
-  // we get the values in the column
-  // we convert the values to string
-  vector<float> rawValues = convertToFloats(rows);
-  // we return the minimum value
-  return getMin(rawValues);
+ColumnStats statsFromMoments(const Moments& moments) {
+  ColumnStats stats;
+  if (moments.count == 0) {
+    // an empty column has no statistics
+    double nan = numeric_limits<double>::quiet_NaN();
+    stats.min = stats.max = stats.mean = stats.variance = nan;
+    stats.stdDeviation = stats.intercept = stats.slope = stats.median = nan;
+    return stats;
+  }
+  stats.count = moments.count;
+  stats.sum = moments.getSum();
+  stats.min = moments.min;
+  stats.max = moments.max;
+  stats.mean = moments.mean;
+  stats.variance = moments.m2 / moments.count;
+  stats.stdDeviation = sqrt(stats.variance);
+  stats.slope = (moments.m2x > 0) ? moments.cxy / moments.m2x : 0;
+  stats.intercept = moments.mean - stats.slope * moments.meanX;
+  return stats;
+}
+
+Moments Column::reduceMoments(const vector<bool>* skip) const {
+  // we split the numbers into runs of rows that are reduced on the shared
+  // thread pool, runs end at skipped rows so the row index x counts only the
+  // rows that are kept, the callers time the reduction so it counts once
+  struct Run {
+    const double* values;
+    size_t count, firstRow;
+  };
+  vector<Run> runs;
+  size_t row = 0, kept = 0;
+  forEachNumberBlock([&](span<const double> block) {
+    size_t i = 0;
+    while (i < block.size()) {
+      if (skip && (*skip)[row + i]) {
+        i++;
+        continue;
+      }
+      size_t start = i;
+      while (i < block.size() && i - start < PARALLEL_CHUNK &&
+             !(skip && (*skip)[row + i])) {
+        i++;
+      }
+      runs.push_back({block.data() + start, i - start, kept});
+      kept += i - start;
+    }
+    row += block.size();
+  });
+  vector<Moments> partials(runs.size());
+  getThreadPool().parallelFor(runs.size(), [&runs, &partials](size_t i) {
+    partials[i] = computeMoments(runs[i].values, runs[i].count,
+                                 runs[i].firstRow);
+  });
+  TABLUZZY_COUNT(rowsScanned, row);
+  // the partial moments are merged in row order
+  Moments total;
+  for (const Moments& partial : partials) total.merge(partial);
+  return total;
+};
+
+vector<double> Column::gatherNumbers(const vector<bool>* skip) const {
+  // we copy the numbers of the rows that are not skipped
+  vector<double> values;
+  values.reserve(numbers.size());
+  size_t row = 0;
+  forEachNumberBlock([&](span<const double> block) {
+    if (!skip) {
+      values.insert(values.end(), block.begin(), block.end());
+    } else {
+      for (size_t i = 0; i < block.size(); i++) {
+        if (!(*skip)[row + i]) values.push_back(block[i]);
+      }
+    }
+    row += block.size();
+  });
+  TABLUZZY_COUNT(rowsScanned, row);
+  return values;
 };
 
-float Column::getMaximumValue() {
-  // we convert all values to float
-  vector<float> rawValues = convertToFloats(rows);
-  // we get the maximum value of the raw values
-  return getMax(rawValues);
+const Moments& Column::getMoments() const {
+  // if nothing changed since the last pass we reuse the cached moments
+  if (statsValid) return moments;
+  TABLUZZY_TIME(statisticsTimer);
+  moments = reduceMoments(nullptr);
+  // we derive the statistics from the moments, keeping a median that is
+  // still valid
+  double median = stats.median;
+  stats = statsFromMoments(moments);
+  if (medianValid) stats.median = median;
+  statsValid = true;
+  return moments;
 };
 
-float Column::getMedian() {
-  // we get all the values in the column and convert the values to float
-  vector<float> values = convertToFloats(rows);
-  // we calculate the median from the set of values
-  return calculateMedian(values);
+const ColumnStats& Column::getStats() const {
+  // we make sure the single pass statistics are up to date
+  getMoments();
+  if (!medianValid) {
+    TABLUZZY_TIME(statisticsTimer);
+    // the median is selected from a copy so the rows keep their order
+    vector<double> values = gatherNumbers(nullptr);
+    stats.median = selectMedian(values);
+    medianValid = true;
+  }
+  return stats;
 };
-float Column::getMean() {
-  // we get all the values in the column and convert the values to float
-  vector<float> values = convertToFloats(rows);
-  // we calculate the mean using calculateMean
-  return calculateMean(values);
+
+Moments Column::getMoments(const vector<bool>& skip) const {
+  TABLUZZY_TIME(statisticsTimer);
+  // statistics of a subset of the rows are never cached
+  return reduceMoments(&skip);
 };
-float Column::getVariance() {
-  // we get all the values in the column and convert the values to float
-  vector<float> values = convertToFloats(rows);
-  // we calculate the variance using calculateVariance
-  return calculateVariance(values);
+
+ColumnStats Column::getStats(const vector<bool>& skip) const {
+  TABLUZZY_TIME(statisticsTimer);
+  // the statistics of the rows that are kept, median included
+  ColumnStats subset = statsFromMoments(reduceMoments(&skip));
+  vector<double> values = gatherNumbers(&skip);
+  subset.median = selectMedian(values);
+  return subset;
 };
-float Column::getStdDeviation() {
-  // we get all the values in the column and convert the values to float
-  vector<float> values = convertToFloats(rows);
-  // we calculate the standard standard deviation from the set of values
-  return calculateStandardDeviation(values);
+
+void Column::invalidateStats() {
+  // the next statistic that is asked for recomputes the cache
+  statsValid = false;
+  medianValid = false;
+};
+
+float Column::getMinimumValue() const {
+  // we return the minimum value derived from the cached moments
+  getMoments();
+  return stats.min;
+};
+
+float Column::getMaximumValue() const {
+  // we return the maximum value derived from the cached moments
+  getMoments();
+  return stats.max;
+};
+
+float Column::getMedian() const {
+  // the median is selected once and cached with the other statistics
+  return getStats().median;
+};
+float Column::getMean() const {
+  // we return the mean derived from the cached moments
+  getMoments();
+  return stats.mean;
+};
+float Column::getVariance() const {
+  // the variance is derived from the moments with the other statistics
+  getMoments();
+  return stats.variance;
+};
+float Column::getStdDeviation() const {
+  // the standard deviation is derived from the moments as well
+  getMoments();
+  return stats.stdDeviation;
 };
 
 vector<string> Column::getAllValues() {
   // declare a vector of values
   vector<string> values;
-  // and then populate it with the values in rows
-  for (int x = 0; x < rows.size(); x++) {
-    values.push_back(rows[x]);
+  values.reserve(getNumberOfRows());
+  // and then populate it with the text of every row
+  for (int x = 0; x < getNumberOfRows(); x++) {
+    values.push_back(getValueAt(x));
   };
   // we return the vector
   return values;
 };
 
-tuple<float, float> Column::getRegression() {
-  // we get all the values in the column and convert the values to float
-  // we convert al the values to flaots
-  vector<float> values = convertToFloats(rows);
-  // we calculate the regression from the values and return
-  return calculateRegression(values);
+tuple<float, float> Column::getRegression() const {
+  // the regression is computed in the same pass as the other statistics
+  getMoments();
+  return {stats.intercept, stats.slope};
 };
 
 vector<int> Column::getPrimes() {
   // we declare vectors to store the primes
   vector<int> primes;
 
-  // we convert all values in rows to ints
-  vector<int> numbers = convertToInts(rows);
+  // we truncate all the numbers to ints
+  vector<int> ints;
+  numbers.forEachChunk([&ints](span<const double> block) {
+    ints.insert(ints.end(), block.begin(), block.end());
+  });
 
   // we populate the vector primes if and only if those numbers are prime
-  for (int num : numbers) {
+  for (int num : ints) {
     if (isPrime(num)) primes.push_back(num);
   }
   // return that list of primes
   return primes;
 };
 
-void Column::insertAtRowIndex(size_t rowIndex, string value) {
+void Column::insertAtRowIndex(size_t rowIndex, const string& value) {
+  invalidateStats();
+  // rows from rowIndex on move down, and so do their index entries
+  if (rowIndex < getNumberOfRows()) shiftIndex(rowIndex, 1);
   // inserts a new value at row Index
-  rows.insert(rows.begin() + rowIndex, value);
+  if (type == ValueType::flt) {
+    numbers.insert(rowIndex, toNumber(value));
+  } else if (encoded) {
+    codes.insert(rowIndex, encodeValue(value));
+  } else {
+    rows.insert(rowIndex, arena.store(value));
+  }
+  indexRow(rowIndex);
+};
+
+void Column::insertAtRowIndex(size_t rowIndex, string&& value) {
+  // the text is copied into the storage either way
+  insertAtRowIndex(rowIndex, static_cast<const string&>(value));
 };
 
 void Column::deleteRow(size_t rowIndex) {
+  invalidateStats();
+  unindexRow(rowIndex);
   // deletes a row at row index
-  rows.erase(rows.begin() + rowIndex);
-};
\ No newline at end of file
+  if (type == ValueType::flt) {
+    numbers.erase(rowIndex);
+  } else if (encoded) {
+    codes.erase(rowIndex);
+  } else {
+    const ChunkedVector<StrRef>& refs = rows;
+    arena.release(refs[rowIndex]);
+    rows.erase(rowIndex);
+    reclaimStrings();
+  }
+  // rows after rowIndex move up, and so do their index entries
+  if (rowIndex < getNumberOfRows()) shiftIndex(rowIndex + 1, -1);
+};
+
+int Column::compareRows(size_t rowIndex1, size_t rowIndex2) const {
+  if (type == ValueType::flt) {
+    double a = numbers[rowIndex1], b = numbers[rowIndex2];
+    // missing numbers (NaN) are ordered after every other number
+    if (isnan(a) || isnan(b)) return isnan(a) - isnan(b);
+    return (a < b) ? -1 : (a > b);
+  }
+  if (encoded) {
+    uint32_t a = codes[rowIndex1], b = codes[rowIndex2];
+    // equal codes stand for equal strings
+    if (a == b) return 0;
+    // ranked codes compare in the order of their strings
+    if (dictionary->hasRanks()) {
+      const vector<uint32_t>& ranks = dictionary->getCachedRanks();
+      return (ranks[a] < ranks[b]) ? -1 : 1;
+    }
+    return getStringAt(rowIndex1).compare(getStringAt(rowIndex2));
+  }
+  // strings compare lexicographically
+  return getStringAt(rowIndex1).compare(getStringAt(rowIndex2));
+};
+
+void Column::prepareCompare() const {
+  // the ranks of the codes are computed once for every comparison to come
+  if (encoded) dictionary->getRanks();
+};
+
+// hashes a number so that the numbers compareRows finds equal hash alike
+static size_t hashNumber(double value) {
+  // every missing number is equal, and so are 0 and -0
+  if (isnan(value)) return 0x7ff8;
+  return hash<double>{}(value == 0 ? 0.0 : value);
+}
+
+size_t Column::hashRow(size_t rowNo) const {
+  if (type == ValueType::flt) return hashNumber(numbers[rowNo]);
+  // distinct codes stand for distinct strings
+  if (encoded) return hash<uint32_t>{}(codes[rowNo]);
+  return hash<string_view>{}(getStringAt(rowNo));
+};
+
+vector<size_t> Column::getValueHashes() const {
+  vector<size_t> hashes(getNumberOfRows());
+  // we hash a chunk of the storage per task
+  auto hashChunks = [&hashes](const auto& values, auto hashValue) {
+    getThreadPool().parallelFor(values.getChunkCount(), [&](size_t c) {
+      auto chunk = values.getChunk(c);
+      size_t start = values.getChunkStart(c);
+      for (size_t i = 0; i < chunk.size(); i++) {
+        hashes[start + i] = hashValue(chunk[i]);
+      }
+    });
+  };
+  if (type == ValueType::flt) {
+    hashChunks(numbers, hashNumber);
+  } else if (encoded) {
+    // every distinct value is hashed once, as the string it stands for
+    vector<size_t> codeHashes(dictionary->size());
+    for (size_t code = 0; code < codeHashes.size(); code++) {
+      codeHashes[code] = hash<string_view>{}(dictionary->decode(code));
+    }
+    hashChunks(codes, [&](uint32_t code) { return codeHashes[code]; });
+  } else {
+    hashChunks(rows, [this](StrRef ref) {
+      return hash<string_view>{}(arena.view(ref));
+    });
+  }
+  TABLUZZY_COUNT(rowsScanned, hashes.size());
+  return hashes;
+};
+
+void Column::swapRows(size_t rowIndex1, size_t rowIndex2) {
+  invalidateStats();
+  unindexRow(rowIndex1);
+  if (rowIndex2 != rowIndex1) unindexRow(rowIndex2);
+  // swapping in the typed storage does not copy any strings
+  if (type == ValueType::flt) {
+    swap(numbers[rowIndex1], numbers[rowIndex2]);
+  } else if (encoded) {
+    swap(codes[rowIndex1], codes[rowIndex2]);
+  } else {
+    swap(rows[rowIndex1], rows[rowIndex2]);
+  }
+  indexRow(rowIndex1);
+  if (rowIndex2 != rowIndex1) indexRow(rowIndex2);
+};
+
+void Column::applyPermutation(const vector<size_t>& permutation) {
+  invalidateStats();
+  // every row may move, so the index is rebuilt by the next lookup
+  invalidateIndex();
+  // we gather the values into new storage in a single pass, reading the old
+  // storage through const references so chunks shared with copies of the
+  // column or borrowed from a snapshot are never copied just to be read
+  if (type == ValueType::flt) {
+    const ChunkedVector<double>& source = numbers;
+    ChunkedVector<double> sorted;
+    sorted.reserve(permutation.size());
+    for (size_t i = 0; i < permutation.size(); i++) {
+      sorted.push_back(source[permutation[i]]);
+    }
+    numbers = move(sorted);
+  } else if (encoded) {
+    // only the codes move, the dictionary stays as it is
+    const ChunkedVector<uint32_t>& source = codes;
+    ChunkedVector<uint32_t> sorted;
+    sorted.reserve(permutation.size());
+    for (size_t i = 0; i < permutation.size(); i++) {
+      sorted.push_back(source[permutation[i]]);
+    }
+    codes = move(sorted);
+  } else {
+    // the strings are copied into a new arena in their new order, which
+    // drops the bytes of overwritten strings and keeps scans sequential
+    const ChunkedVector<StrRef>& source = rows;
+    ChunkedVector<StrRef> sorted;
+    StringArena packed;
+    sorted.reserve(permutation.size());
+    for (size_t i = 0; i < permutation.size(); i++) {
+      sorted.push_back(packed.store(arena.view(source[permutation[i]])));
+    }
+    rows = move(sorted);
+    arena.swap(packed);
+  }
+};
+void Column::createIndex() {
+  // the index is built right away and kept up to date from now on
+  indexed = true;
+  indexValid = false;
+  refreshIndex();
+};
+
+void Column::dropIndex() {
+  // we stop maintaining the index and free its memory
+  indexed = false;
+  indexValid = false;
+  stringIndex = make_shared<StringIndex>();
+  numberIndex = make_shared<NumberIndex>();
+};
+
+bool Column::hasIndex() const {
+  // returns whether the column keeps a secondary index
+  return indexed;
+};
+
+void Column::refreshIndex() const {
+  if (!indexed) return;
+  // an up to date index only moves the rows shifted since the last lookup,
+  // in its own storage if it is shared with copies of the column
+  if (indexValid) {
+    if (numberIndex->getPendingEdits() > 0) {
+      if (!isOnlyOwner(numberIndex)) {
+        numberIndex = make_shared<NumberIndex>(*numberIndex);
+      }
+      numberIndex->flush();
+    }
+    if (stringIndex->getPendingEdits() > 0) {
+      if (!isOnlyOwner(stringIndex)) {
+        stringIndex = make_shared<StringIndex>(*stringIndex);
+      }
+      stringIndex->flush();
+    }
+    return;
+  }
+  // an index that is kept but out of date is rebuilt
+  // the index is rebuilt into new storage, as the old one may be shared with
+  // copies of the column
+  stringIndex = make_shared<StringIndex>();
+  numberIndex = make_shared<NumberIndex>();
+  if (type == ValueType::flt) {
+    numberIndex->build(numbers);
+  } else {
+    stringIndex->build(getNumberOfRows(),
+                       [this](size_t row) { return getStringAt(row); });
+  }
+  indexValid = true;
+};
+
+StringIndex& Column::editStringIndex() {
+  if (!isOnlyOwner(stringIndex)) {
+    stringIndex = make_shared<StringIndex>(*stringIndex);
+  }
+  return *stringIndex;
+};
+
+NumberIndex& Column::editNumberIndex() {
+  if (!isOnlyOwner(numberIndex)) {
+    numberIndex = make_shared<NumberIndex>(*numberIndex);
+  }
+  return *numberIndex;
+};
+
+void Column::invalidateIndex() {
+  // the next lookup rebuilds the index from scratch
+  indexValid = false;
+};
+
+void Column::indexRow(size_t row) {
+  // an index that is out of date is rebuilt as a whole anyway
+  if (!indexValid) return;
+  size_t pending;
+  if (type == ValueType::flt) {
+    editNumberIndex().add(numbers[row], row);
+    pending = numberIndex->getPendingEdits();
+  } else {
+    editStringIndex().add(getStringAt(row), row);
+    pending = stringIndex->getPendingEdits();
+  }
+  if (pending > MAX_PENDING_INDEX_EDITS) invalidateIndex();
+};
+
+void Column::unindexRow(size_t row) {
+  if (!indexValid) return;
+  if (type == ValueType::flt) {
+    editNumberIndex().remove(numbers[row], row);
+  } else {
+    editStringIndex().remove(getStringAt(row), row);
+  }
+};
+
+void Column::shiftIndex(size_t from, ptrdiff_t delta) {
+  // the entries are moved by the next lookup, all moves in one pass, instead
+  // of rebuilding the index
+  if (!indexValid) return;
+  size_t pending;
+  if (type == ValueType::flt) {
+    editNumberIndex().shift(from, delta);
+    pending = numberIndex->getPendingEdits();
+  } else {
+    editStringIndex().shift(from, delta);
+    pending = stringIndex->getPendingEdits();
+  }
+  if (pending > MAX_PENDING_INDEX_EDITS) invalidateIndex();
+};
+
+int Column::findFirstRow(string_view value) const {
+  // string values are only held by string columns
+  if (type != ValueType::str) return -1;
+  // an indexed column answers from its hash index
+  refreshIndex();
+  if (indexed) return stringIndex->first(value);
+  // otherwise we scan the column, an encoded column compares codes
+  if (encoded) {
+    long long code = dictionary->find(value);
+    if (code == -1) return -1;
+    for (size_t i = 0; i < codes.size(); i++) {
+      if (codes[i] == code) {
+        TABLUZZY_COUNT(rowsScanned, i + 1);
+        return i;
+      }
+    }
+    TABLUZZY_COUNT(rowsScanned, codes.size());
+    return -1;
+  }
+  for (size_t i = 0; i < rows.size(); i++) {
+    if (arena.view(rows[i]) == value) {
+      TABLUZZY_COUNT(rowsScanned, i + 1);
+      return i;
+    }
+  }
+  TABLUZZY_COUNT(rowsScanned, rows.size());
+  return -1;
+};
+
+int Column::findFirstRow(double value) const {
+  // numbers are only held by float columns
+  if (type != ValueType::flt) return -1;
+  // an indexed column answers from its sorted index
+  refreshIndex();
+  if (indexed) return numberIndex->first(value);
+  // otherwise we scan the column
+  for (size_t i = 0; i < numbers.size(); i++) {
+    if (numbers[i] == value) {
+      TABLUZZY_COUNT(rowsScanned, i + 1);
+      return i;
+    }
+  }
+  TABLUZZY_COUNT(rowsScanned, numbers.size());
+  return -1;
+};
+
+vector<size_t> Column::findAllRows(string_view value) const {
+  if (type != ValueType::str) return {};
+  refreshIndex();
+  if (indexed) return stringIndex->all(value);
+  // without an index we collect the matches of a scan
+  TABLUZZY_COUNT(rowsScanned, getNumberOfRows());
+  vector<size_t> found;
+  if (encoded) {
+    long long code = dictionary->find(value);
+    if (code == -1) return found;
+    for (size_t i = 0; i < codes.size(); i++) {
+      if (codes[i] == code) found.push_back(i);
+    }
+    return found;
+  }
+  for (size_t i = 0; i < rows.size(); i++) {
+    if (arena.view(rows[i]) == value) found.push_back(i);
+  }
+  return found;
+};
+
+vector<size_t> Column::findAllRows(double value) const {
+  if (type != ValueType::flt) return {};
+  refreshIndex();
+  if (indexed) return numberIndex->all(value);
+  // without an index we collect the matches of a scan
+  TABLUZZY_COUNT(rowsScanned, numbers.size());
+  vector<size_t> found;
+  for (size_t i = 0; i < numbers.size(); i++) {
+    if (numbers[i] == value) found.push_back(i);
+  }
+  return found;
+};
+
+vector<size_t> Column::findRowsInRange(double low, double high) const {
+  if (type != ValueType::flt) return {};
+  refreshIndex();
+  if (indexed) return numberIndex->range(low, high);
+  // without an index we collect the matches of a scan, missing numbers fail
+  // both comparisons
+  TABLUZZY_COUNT(rowsScanned, numbers.size());
+  vector<size_t> found;
+  for (size_t i = 0; i < numbers.size(); i++) {
+    if (numbers[i] >= low && numbers[i] <= high) found.push_back(i);
+  }
+  return found;
+};
+
+void Column::setStringEncoding(StringEncoding encoding) {
+  // only string columns are encoded
+  if (type != ValueType::str) return;
+  encodedAutomatically = (encoding == automaticEncoding);
+  bool encode = (encoding == dictionaryEncoding);
+  if (encoding == automaticEncoding) {
+    // we count the distinct values unless the dictionary already knows them
+    size_t count = getNumberOfRows(), distinct;
+    if (encoded) {
+      distinct = dictionary->size();
+    } else {
+      unordered_set<string_view> values;
+      for (size_t y = 0; y < count; y++) values.insert(getStringAt(y));
+      distinct = values.size();
+    }
+    // and encode the column if at most half of its values are distinct
+    encode = distinct * 2 <= count;
+  }
+  // if the encoding does not change the storage stays as it is
+  if (encode == encoded) return;
+
+  invalidateStats();
+  if (encode) {
+    // every string is replaced by its code, the strings are read through a
+    // const reference so shared chunks are not copied before they are let go
+    const ChunkedVector<StrRef>& strings = rows;
+    dictionary = make_shared<Dictionary>();
+    codes.reserve(strings.size());
+    for (size_t y = 0; y < strings.size(); y++) {
+      codes.push_back(encodeValue(arena.view(strings[y])));
+    }
+    rows.clear();
+    arena.clear();
+  } else {
+    // every code is replaced by a copy of its string, read the same way
+    const ChunkedVector<uint32_t>& encodedRows = codes;
+    rows.reserve(encodedRows.size());
+    for (size_t y = 0; y < encodedRows.size(); y++) {
+      rows.push_back(arena.store(dictionary->decode(encodedRows[y])));
+    }
+    codes.clear();
+    dictionary.reset();
+  }
+  encoded = encode;
+};
+
+StringEncoding Column::getStringEncoding() const {
+  // returns how the values are stored right now
+  return encoded ? dictionaryEncoding : plainEncoding;
+};
+
+size_t Column::getDictionarySize() const {
+  // returns the number of distinct values of an encoded column
+  return encoded ? dictionary->size() : 0;
+};
+
+size_t Column::getStringBytes() const {
+  // only plain string columns keep their strings in the arena
+  return (type == ValueType::str && !encoded) ? arena.getStoredBytes() : 0;
+};
+
+void Column::reclaimStrings() {
+  // small arenas fit in a single block anyway, and bigger ones are only
+  // repacked once the dead bytes outweigh the live ones, so repacking costs
+  // at most as much as the strings that were stored since the last time
+  if (arena.getStoredBytes() <= StringArena::BLOCK_SIZE ||
+      arena.getDeadBytes() * 2 <= arena.getStoredBytes()) {
+    return;
+  }
+  // the strings are copied in row order, their rows and index stay the same
+  const ChunkedVector<StrRef>& refs = rows;
+  ChunkedVector<StrRef> repacked;
+  StringArena packed;
+  repacked.reserve(refs.size());
+  for (size_t y = 0; y < refs.size(); y++) {
+    repacked.push_back(packed.store(arena.view(refs[y])));
+  }
+  rows = move(repacked);
+  arena.swap(packed);
+};
+
+uint32_t Column::encodeValue(string_view value) {
+  // a value the dictionary already holds leaves it as it is
+  long long found = dictionary->find(value);
+  if (found != -1) return found;
+  // a dictionary shared with copies of the column is copied before it grows
+  if (!isOnlyOwner(dictionary)) dictionary = dictionary->copy();
+  return dictionary->encode(value);
+};
+
+void Column::checkEncoding() {
+  // the encoding is only checked for automatically encoded columns, every
+  // time a chunk of rows was appended
+  if (!encoded || !encodedAutomatically) return;
+  if (codes.size() % ENCODING_CHECK_ROWS != 0) return;
+  // a column with more than half of its values distinct is stored plainly
+  if (dictionary->size() * 2 > codes.size()) {
+    setStringEncoding(plainEncoding);
+    // but we keep choosing the encoding automatically
+    encodedAutomatically = true;
+  }
+};
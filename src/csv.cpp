@@ -0,0 +1,398 @@
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+
+#include "mapping.hpp"
+#include "tabluzzy.hpp"
+
+using namespace std;
+
+// the size of the blocks a csv stream is read in
+static const size_t CSV_CHUNK_SIZE = 1 << 20;
+// the smallest part of the input a thread parses on its own
+static const size_t CSV_PART_SIZE = 1 << 20;
+// the number of parts handed to every thread, so uneven parts balance out
+static const size_t CSV_PARTS_PER_THREAD = 4;
+
+// finds the newline that ends the record at the start of text, newlines inside
+// quoted fields do not end a record, returns npos if the record is incomplete,
+// quoted tells whether text starts inside of a quoted field
+static size_t findRecordEnd(string_view text, bool quoted = false) {
+  size_t start = 0;
+  while (true) {
+    // we jump straight to the next newline
+    size_t newline = text.find('\n', start);
+    if (newline == string_view::npos) return string_view::npos;
+    // and toggle the quote state for every quote we jumped over, searching
+    // only up to the newline so every byte is scanned once
+    const char* end = text.data() + newline;
+    for (const char* quote = text.data() + start;
+         (quote = (const char*)memchr(quote, '"', end - quote)) != nullptr;
+         quote++) {
+      quoted = !quoted;
+    }
+    // the newline only ends the record if it is not inside quotes
+    if (!quoted) return newline;
+    start = newline + 1;
+  }
+}
+
+// builds the error of a data record with too few fields
+static runtime_error rowError(size_t row, size_t fieldCount, size_t colNo) {
+  return runtime_error("csv row " + to_string(row) + " has " +
+                       to_string(fieldCount) + " fields, expected " +
+                       to_string(colNo));
+}
+
+// builds the error of a header or datatype record with too few fields
+static runtime_error headerError(const string& record, size_t fieldCount,
+                                 size_t colNo) {
+  return runtime_error("csv " + record + " record has " +
+                       to_string(fieldCount) + " fields, expected " +
+                       to_string(colNo));
+}
+
+/// @brief Loader that tokenizes csv records in place and writes the fields
+/// straight into the columns of a table
+class CsvReader {
+ public:
+  CsvReader(Table& t) : table(t) {}
+
+  /// @brief constructor for a reader of a part of the data records, that
+  /// fills a table with the columns of header
+  /// @param part the table to fill
+  /// @param header the reader that read the header block
+  CsvReader(Table& part, const CsvReader& header)
+      : table(part), record(4), colNo(header.colNo) {
+    for (const Column& col : header.table.data) {
+      table.addColumn(col.getHeader(), col.getValueType());
+      table.data.back().setStringEncoding(automaticEncoding);
+    }
+    // a part never holds more rows than the whole input announced
+    table.rows = header.table.rows;
+  }
+
+  /// @brief tokenizes every complete record at the start of text
+  /// @param text the text to read records from
+  /// @param last whether text is the end of the input
+  /// @return the number of bytes that were consumed
+  size_t consume(string_view text, bool last) {
+    size_t consumed = 0;
+    while (consumed < text.size() && !done()) {
+      string_view rest = text.substr(consumed);
+      size_t end = findRecordEnd(rest);
+      if (end == string_view::npos) {
+        // an unterminated record is only complete at the end of the input
+        if (!last) break;
+        end = rest.size();
+      }
+      readRecord(rest.substr(0, end));
+      consumed += min(end + 1, rest.size());
+    }
+    return consumed;
+  }
+
+  /// @brief whether every row announced by the header block has been read
+  bool done() const {
+    return record >= 4 && (headerOnly || loaded == table.rows);
+  }
+
+  /// @brief reads the header block at the start of text and adds the columns
+  /// @param text the input
+  /// @return the number of bytes of the header block
+  size_t readHeader(string_view text) {
+    headerOnly = true;
+    size_t consumed = consume(text, true);
+    headerOnly = false;
+    return consumed;
+  }
+
+  /// @brief reads the data records of text with every thread of the pool,
+  /// the text is split into parts at the ends of records, every part is
+  /// tokenized and converted into columns of its own, and the columns of
+  /// the parts are then joined in order
+  /// @param text the input after the header block
+  void readParallel(string_view text) {
+    // an input that ended within the header block has no rows to read
+    if (record < 4 || table.rows == 0) return;
+    size_t threads = getThreadCount();
+    size_t partCount = min(threads * CSV_PARTS_PER_THREAD,
+                           text.size() / CSV_PART_SIZE + 1);
+    size_t partSize = text.size() / partCount + 1;
+
+    // a record can only be split at a newline outside of quotes, so we need
+    // to know whether every part starts inside of quotes, which is the case
+    // if an odd number of quotes comes before it
+    vector<size_t> quotes(partCount);
+    getThreadPool().parallelFor(partCount, [&](size_t p) {
+      string_view part = text.substr(min(p * partSize, text.size()), partSize);
+      quotes[p] = count(part.begin(), part.end(), '"');
+    });
+    vector<bool> quoted(partCount, false);
+    for (size_t p = 1; p < partCount; p++) {
+      quoted[p] = quoted[p - 1] != (quotes[p - 1] % 2 == 1);
+    }
+    // a part is moved forward to the first record that starts in it
+    auto partStart = [&](size_t p) {
+      if (p == 0) return size_t(0);
+      if (p >= partCount) return text.size();
+      size_t start = min(p * partSize, text.size());
+      size_t end = findRecordEnd(text.substr(start), quoted[p]);
+      return (end == string_view::npos) ? text.size() : start + end + 1;
+    };
+
+    vector<Table> parts(partCount);
+    vector<size_t> loadedRows(partCount, 0), shortRows(partCount, 0);
+    vector<exception_ptr> errors(partCount);
+    vector<ParseReport> partReports(partCount);
+    getThreadPool().parallelFor(partCount, [&](size_t p) {
+      size_t start = partStart(p), end = partStart(p + 1);
+      CsvReader reader(parts[p], *this);
+      try {
+        reader.consume(text.substr(start, end - start), true);
+      } catch (...) {
+        // errors are only reported if they happen within the rows announced
+        // by the header block, which is not known until the parts are joined
+        errors[p] = current_exception();
+        shortRows[p] = reader.shortRow;
+      }
+      loadedRows[p] = reader.loaded;
+      partReports[p] = reader.report;
+    });
+
+    // the parts are joined in order until the announced rows are loaded
+    size_t total = 0;
+    vector<size_t> taken(partCount, 0);
+    for (size_t p = 0; p < partCount && total < table.rows; p++) {
+      taken[p] = min(loadedRows[p], table.rows - total);
+      report.merge(partReports[p], total);
+      total += taken[p];
+      if (errors[p] && total < table.rows) {
+        // a record with too few fields is reported at its row in the table
+        if (shortRows[p] != 0) throw rowError(total, shortRows[p] - 1, colNo);
+        rethrow_exception(errors[p]);
+      }
+    }
+    getThreadPool().parallelFor(colNo, [&](size_t x) {
+      Column& col = table.data[x];
+      for (size_t p = 0; p < partCount; p++) {
+        if (taken[p] > 0) col.appendRows(parts[p].data[x], taken[p]);
+      }
+    });
+    loaded = total;
+  }
+
+  /// @brief finishes the table once the input has been consumed
+  void finish() {
+    // if the input held fewer rows than announced we keep what was read
+    table.rows = loaded;
+    table.parseReport = report;
+    // now that every value was seen we settle the encoding of the string
+    // columns
+    for (Column& col : table.data) col.setStringEncoding(automaticEncoding);
+  }
+
+ private:
+  // the table being populated
+  Table& table;
+  // the number of records read so far, the first four are the header block
+  size_t record = 0;
+  // the number of data rows read so far
+  size_t loaded = 0;
+  // the number of columns announced by the first record
+  size_t colNo = 0;
+  // the fields of the current record, pointing into the input where possible
+  vector<string_view> fields;
+  // unescaped copies of quoted fields that contained doubled quotes
+  deque<string> unescaped;
+  // the cells read so far that were not numbers
+  ParseReport report;
+  // the headers read from the third record
+  vector<string> headers;
+  // set while only the header block is read
+  bool headerOnly = false;
+  // one more than the number of fields of a record that had too few
+  size_t shortRow = 0;
+
+  // splits a record into its fields without copying them
+  void split(string_view line) {
+    fields.clear();
+    unescaped.clear();
+    // we drop the carriage return of windows line endings
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+    size_t pos = 0;
+    while (true) {
+      if (pos < line.size() && line[pos] == '"') {
+        // a quoted field runs until a quote that is not doubled
+        size_t start = pos + 1, end = start;
+        bool escaped = false;
+        while (end < line.size()) {
+          if (line[end] == '"') {
+            if (end + 1 < line.size() && line[end + 1] == '"') {
+              escaped = true;
+              end += 2;
+              continue;
+            }
+            break;
+          }
+          end++;
+        }
+        string_view field = line.substr(start, end - start);
+        if (escaped) {
+          // only fields with doubled quotes have to be copied
+          string& copy = unescaped.emplace_back();
+          for (size_t i = 0; i < field.size(); i++) {
+            copy.push_back(field[i]);
+            if (field[i] == '"') i++;
+          }
+          field = copy;
+        }
+        fields.push_back(field);
+        pos = line.find(',', end);
+      } else {
+        size_t comma = line.find(',', pos);
+        fields.push_back(line.substr(pos, comma - pos));
+        pos = comma;
+      }
+      if (pos == string_view::npos) break;
+      pos++;
+    }
+  }
+
+  // handles one record of the input
+  void readRecord(string_view line) {
+    split(line);
+    switch (record++) {
+      case 0:
+        // the first record holds the number of columns
+        if (!parseCount(fields[0], colNo)) {
+          throw runtime_error("csv does not start with its dimensions");
+        }
+        break;
+      case 1: {
+        // the second record holds the number of rows
+        size_t rowNo;
+        if (!parseCount(fields[0], rowNo)) {
+          throw runtime_error("csv does not start with its dimensions");
+        }
+        table.rows = rowNo;
+        break;
+      }
+      case 2:
+        // the third record holds the headers
+        for (string_view field : fields) headers.emplace_back(field);
+        break;
+      case 3:
+        // the fourth record holds the datatypes, so the columns can be added
+        // once both records name every column
+        if (headers.size() < colNo) {
+          throw headerError("header", headers.size(), colNo);
+        }
+        if (fields.size() < colNo) {
+          throw headerError("datatype", fields.size(), colNo);
+        }
+        for (size_t x = 0; x < colNo; x++) {
+          ValueType dttype =
+              (fields[x] == "number") ? ValueType::flt : ValueType::str;
+          table.addColumn(headers[x], dttype);
+          // string columns are dictionary encoded while they repeat their
+          // values
+          table.data.back().setStringEncoding(automaticEncoding);
+          // we know the number of rows so we reserve the storage up front
+          table.data.back().reserve(table.rows);
+        }
+        break;
+      default:
+        readRow();
+    }
+  }
+
+  // writes the fields of a data record into the columns
+  void readRow() {
+    if (fields.size() < colNo) {
+      shortRow = fields.size() + 1;
+      throw rowError(loaded, fields.size(), colNo);
+    }
+    for (size_t x = 0; x < colNo; x++) {
+      Column& col = table.data[x];
+      if (col.getValueType() == ValueType::flt) {
+        // numbers are parsed straight from the input into the numerical
+        // storage, cells that are not numbers are stored as NaN and counted
+        double number;
+        report.add(parseNumber(fields[x], number), loaded, x);
+        col.pushNumber(number);
+      } else {
+        // strings are only copied if the column has to store them
+        col.pushString(fields[x]);
+      }
+    }
+    loaded++;
+  }
+};
+
+void Table::from_csv(istream& in) {
+  TABLUZZY_TIME(csvLoadTimer);
+  CsvReader reader(*this);
+  // the buffer holds one chunk plus the unfinished record of the last chunk
+  string buffer(CSV_CHUNK_SIZE, '\0');
+  size_t filled = 0;
+  while (!reader.done()) {
+    // if a single record does not fit in the buffer we grow it
+    if (filled == buffer.size()) buffer.resize(buffer.size() * 2);
+    in.read(&buffer[filled], buffer.size() - filled);
+    filled += in.gcount();
+    bool last = !in;
+    size_t consumed = reader.consume(string_view(buffer.data(), filled), last);
+    // the unfinished record is moved to the front of the buffer
+    memmove(&buffer[0], &buffer[consumed], filled - consumed);
+    filled -= consumed;
+    if (last) break;
+  }
+  reader.finish();
+}
+
+void Table::from_csv_parallel(const string& path) {
+  TABLUZZY_TIME(csvLoadTimer);
+  string_view text;
+  string buffer;
+#ifdef TABLUZZY_HAS_MMAP
+  MappedFile mapping(path);
+  text = string_view(mapping.bytes, mapping.size);
+#endif
+  if (!text.data()) {
+    // if the file could not be mapped we read all of it into memory instead
+    ifstream file(path, ios::binary);
+    if (!file) throw runtime_error("could not open csv file " + path);
+    buffer.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    text = buffer;
+  }
+  CsvReader reader(*this);
+  size_t headerSize = reader.readHeader(text);
+  reader.readParallel(text.substr(headerSize));
+  reader.finish();
+}
+
+void Table::from_csv(const string& path) {
+#ifdef TABLUZZY_HAS_MMAP
+  MappedFile mapping(path);
+  if (mapping.bytes) {
+    TABLUZZY_TIME(csvLoadTimer);
+    // the pages are read once from front to back
+    madvise(const_cast<char*>(mapping.bytes), mapping.size, MADV_SEQUENTIAL);
+    CsvReader reader(*this);
+    reader.consume(string_view(mapping.bytes, mapping.size), true);
+    reader.finish();
+    return;
+  }
+#endif
+  // if the file could not be mapped we stream it in chunks instead
+  ifstream file(path, ios::binary);
+  if (!file) throw runtime_error("could not open csv file " + path);
+  from_csv(file);
+}
@@ -0,0 +1,284 @@
+#include <atomic>
+#include <bit>
+#include <stdexcept>
+
+#include "filter.hpp"
+#include "tabluzzy.hpp"
+
+using namespace std;
+
+Selection::Selection(size_t count, bool selected)
+    : words((count + 63) / 64, selected ? ~uint64_t(0) : 0), rowCount(count) {
+  // the bits past the last row stay 0
+  if (selected && count % 64 != 0) {
+    words.back() = (uint64_t(1) << (count % 64)) - 1;
+  }
+}
+
+size_t Selection::count() const {
+  size_t selected = 0;
+  for (uint64_t word : words) selected += popcount(word);
+  return selected;
+}
+
+vector<size_t> Selection::getRowIndexes() const {
+  vector<size_t> rows;
+  rows.reserve(count());
+  for (size_t w = 0; w < words.size(); w++) {
+    // we jump from set bit to set bit
+    for (uint64_t word = words[w]; word != 0; word &= word - 1) {
+      rows.push_back(w * 64 + countr_zero(word));
+    }
+  }
+  return rows;
+}
+
+Selection& Selection::operator&=(const Selection& other) {
+  for (size_t w = 0; w < words.size(); w++) words[w] &= other.words[w];
+  return *this;
+}
+
+Selection& Selection::operator|=(const Selection& other) {
+  for (size_t w = 0; w < words.size(); w++) words[w] |= other.words[w];
+  return *this;
+}
+
+void Selection::invert() {
+  for (uint64_t& word : words) word = ~word;
+  // the bits past the last row stay 0
+  if (rowCount % 64 != 0) words.back() &= (uint64_t(1) << (rowCount % 64)) - 1;
+}
+
+// sets the bits of the values of a block that pass test, the first value
+// being row firstRow, blocks are tested in parallel so the words a block
+// shares with its neighbours are written atomically
+template <typename T, typename Test>
+static void selectBlock(span<const T> values, size_t firstRow, Test test,
+                        vector<uint64_t>& words) {
+  size_t i = 0, n = values.size();
+  auto setShared = [&](size_t row) {
+    atomic_ref<uint64_t>(words[row / 64])
+        .fetch_or(uint64_t(1) << (row % 64), memory_order_relaxed);
+  };
+  // the values before the first whole word
+  for (; i < n && (firstRow + i) % 64 != 0; i++) {
+    if (test(values[i])) setShared(firstRow + i);
+  }
+  // whole words belong to this block alone, so their 64 tests are packed
+  // into the word without branches
+  for (; i + 64 <= n; i += 64) {
+    uint64_t word = 0;
+    for (size_t b = 0; b < 64; b++) {
+      word |= uint64_t(test(values[i + b])) << b;
+    }
+    words[(firstRow + i) / 64] = word;
+  }
+  // and the values after the last whole word
+  for (; i < n; i++) {
+    if (test(values[i])) setShared(firstRow + i);
+  }
+}
+
+// tests every value of a chunked vector, a chunk per task of the pool
+template <typename T, typename Test>
+static void selectValues(const ChunkedVector<T>& values, Test test,
+                         Selection& selection) {
+  vector<uint64_t>& words = selection.getWords();
+  getThreadPool().parallelFor(values.getChunkCount(), [&](size_t c) {
+    selectBlock(values.getChunk(c), values.getChunkStart(c), test, words);
+  });
+  TABLUZZY_COUNT(rowsScanned, values.size());
+}
+
+// applies a comparison to the result of a three way comparison
+static bool compareResult(int order, CompareOp op) {
+  switch (op) {
+    case equalTo:
+      return order == 0;
+    case notEqualTo:
+      return order != 0;
+    case lessThan:
+      return order < 0;
+    case lessOrEqual:
+      return order <= 0;
+    case greaterThan:
+      return order > 0;
+    default:
+      return order >= 0;
+  }
+}
+
+Predicate Predicate::compare(const string& header, CompareOp op,
+                             double value) {
+  return Predicate(make_shared<const Node>(
+      Node{numberNode, header, op, value, value, "", nullptr, nullptr}));
+}
+
+Predicate Predicate::compare(const string& header, CompareOp op,
+                             const string& value) {
+  return Predicate(make_shared<const Node>(
+      Node{stringNode, header, op, 0, 0, value, nullptr, nullptr}));
+}
+
+Predicate Predicate::between(const string& header, double low, double high) {
+  return Predicate(make_shared<const Node>(
+      Node{rangeNode, header, equalTo, low, high, "", nullptr, nullptr}));
+}
+
+Predicate Predicate::startsWith(const string& header, const string& prefix) {
+  return Predicate(make_shared<const Node>(
+      Node{prefixNode, header, equalTo, 0, 0, prefix, nullptr, nullptr}));
+}
+
+Predicate Predicate::operator&&(const Predicate& other) const {
+  return Predicate(make_shared<const Node>(
+      Node{andNode, "", equalTo, 0, 0, "", node, other.node}));
+}
+
+Predicate Predicate::operator||(const Predicate& other) const {
+  return Predicate(make_shared<const Node>(
+      Node{orNode, "", equalTo, 0, 0, "", node, other.node}));
+}
+
+Predicate Predicate::operator!() const {
+  return Predicate(make_shared<const Node>(
+      Node{notNode, "", equalTo, 0, 0, "", node, nullptr}));
+}
+
+Selection Predicate::evaluate(Table& table) const {
+  TABLUZZY_TIME(filterTimer);
+  // the selection holds positions, so pending deletions are applied first
+  table.compact();
+  return evaluateNode(*node, table);
+}
+
+Selection Predicate::evaluateNode(const Node& node,
+                                  const Table& table) {
+  switch (node.kind) {
+    case andNode: {
+      Selection selection = evaluateNode(*node.left, table);
+      // nothing is left to keep once nothing is selected
+      if (selection.count() == 0) return selection;
+      selection &= evaluateNode(*node.right, table);
+      return selection;
+    }
+    case orNode: {
+      Selection selection = evaluateNode(*node.left, table);
+      selection |= evaluateNode(*node.right, table);
+      return selection;
+    }
+    case notNode: {
+      Selection selection = evaluateNode(*node.left, table);
+      selection.invert();
+      return selection;
+    }
+    default: {
+      int index = table.findColumnIndex(node.header);
+      if (index == -1) {
+        throw runtime_error("no column with header " + node.header);
+      }
+      Selection selection(table.rows);
+      evaluateColumn(node, table.data[index], selection);
+      return selection;
+    }
+  }
+}
+
+void Predicate::evaluateColumn(const Node& node, const Column& col,
+                               Selection& selection) {
+  bool numerical = (node.kind == numberNode || node.kind == rangeNode);
+  if (numerical != (col.type == ValueType::flt)) {
+    throw runtime_error("column " + node.header + " does not hold " +
+                        (numerical ? "numbers" : "strings"));
+  }
+  if (node.kind == rangeNode) {
+    double low = node.low, high = node.high;
+    selectValues(col.numbers,
+                 [=](double v) { return v >= low && v <= high; }, selection);
+    return;
+  }
+  if (node.kind == numberNode) {
+    // every comparison gets its own loop so the compiler can vectorize it,
+    // missing numbers (NaN) fail every comparison
+    double value = node.low;
+    switch (node.op) {
+      case equalTo:
+        selectValues(col.numbers, [=](double v) { return v == value; },
+                     selection);
+        break;
+      case notEqualTo:
+        selectValues(col.numbers,
+                     [=](double v) { return v != value && v == v; },
+                     selection);
+        break;
+      case lessThan:
+        selectValues(col.numbers, [=](double v) { return v < value; },
+                     selection);
+        break;
+      case lessOrEqual:
+        selectValues(col.numbers, [=](double v) { return v <= value; },
+                     selection);
+        break;
+      case greaterThan:
+        selectValues(col.numbers, [=](double v) { return v > value; },
+                     selection);
+        break;
+      case greaterOrEqual:
+        selectValues(col.numbers, [=](double v) { return v >= value; },
+                     selection);
+        break;
+    }
+    return;
+  }
+  // a string test on a single string
+  string_view text = node.text;
+  auto matches = [&](string_view value) {
+    if (node.kind == prefixNode) return value.starts_with(text);
+    return compareResult(value.compare(text), node.op);
+  };
+  if (col.encoded) {
+    // an encoded column tests every distinct value once, and then its rows
+    // by their codes
+    if (node.kind == stringNode && node.op == equalTo) {
+      long long found = col.dictionary->find(text);
+      uint32_t code = (found == -1) ? UINT32_MAX : uint32_t(found);
+      selectValues(col.codes, [=](uint32_t c) { return c == code; },
+                   selection);
+      return;
+    }
+    vector<uint8_t> codeMatches(col.dictionary->size());
+    for (size_t code = 0; code < codeMatches.size(); code++) {
+      codeMatches[code] = matches(col.dictionary->decode(code));
+    }
+    const uint8_t* table = codeMatches.data();
+    selectValues(col.codes, [=](uint32_t c) { return table[c] != 0; },
+                 selection);
+    return;
+  }
+  // a plain column views every string in the arena
+  const StringArena& arena = col.arena;
+  selectValues(
+      col.rows, [&](StrRef ref) { return matches(arena.view(ref)); },
+      selection);
+}
+
+vector<size_t> Table::filterRows(const Predicate& predicate) {
+  // the rows that match, by their position
+  return predicate.evaluate(*this).getRowIndexes();
+}
+
+Table Table::filter(const Predicate& predicate) {
+  vector<size_t> selected = filterRows(predicate);
+  // the new table has the columns of this one, stored the same way
+  Table filtered;
+  for (const Column& col : data) {
+    filtered.addColumn(col.getHeader(), col.getValueType());
+    filtered.data.back().setStringEncoding(col.getStringEncoding());
+  }
+  // and the rows that match, gathered a column per task
+  getThreadPool().parallelFor(data.size(), [&](size_t x) {
+    filtered.data[x].appendRowsAt(data[x], selected);
+  });
+  filtered.rows = selected.size();
+  return filtered;
+}
@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#include "tabluzzy.hpp"
+
+using namespace std;
+
+// the number of rows a thread groups at least before another thread helps
+static const size_t GROUP_CHUNK = 1 << 16;
+
+// the statistics every value column is aggregated into, and the suffixes of
+// their headers
+static const char* AGGREGATE_SUFFIXES[] = {"_sum", "_min", "_max", "_mean",
+                                           "_variance"};
+
+// numbers a header that a column of table already has, with 2, 3 and so on,
+// until it is unique
+static string uniqueHeader(Table& table, const string& header) {
+  if (!table.columnExists(header)) return header;
+  string numbered;
+  for (int n = 2;; n++) {
+    numbered = header + to_string(n);
+    if (!table.columnExists(numbered)) return numbered;
+  }
+}
+
+// an open addressing hash table of the groups of some rows of a table, a
+// group is identified by its first row, which holds its keys, and holds the
+// moments of every value column over its rows
+class GroupTable {
+ public:
+  GroupTable(const vector<const Column*>& keys, size_t valueCount)
+      : keys(keys), valueCount(valueCount), slots(16, 0) {}
+
+  // finds the group of the keys at row, adding a group if there is none yet
+  size_t find(size_t row, size_t hash) {
+    size_t mask = slots.size() - 1;
+    // linear probing, from the slot of the hash to the first empty slot
+    for (size_t s = hash & mask;; s = (s + 1) & mask) {
+      uint32_t slot = slots[s];
+      if (slot == 0) {
+        slots[s] = firstRows.size() + 1;
+        firstRows.push_back(row);
+        hashes.push_back(hash);
+        counts.push_back(0);
+        moments.resize(moments.size() + valueCount);
+        // the table is kept at most half full so probes stay short
+        if (firstRows.size() * 2 > slots.size()) grow();
+        return firstRows.size() - 1;
+      }
+      size_t group = slot - 1;
+      if (hashes[group] == hash && sameKeys(firstRows[group], row)) {
+        return group;
+      }
+    }
+  }
+
+  // the first row of every group, in the order the groups were added
+  vector<size_t> firstRows;
+  // the hash of the keys of every group
+  vector<size_t> hashes;
+  // the number of rows of every group
+  vector<size_t> counts;
+  // the moments of every value column of every group, a group after the
+  // other
+  vector<Moments> moments;
+
+ private:
+  // the key columns of the table
+  const vector<const Column*>& keys;
+  // the number of value columns
+  size_t valueCount;
+  // the group of every slot plus 1, 0 for an empty slot
+  vector<uint32_t> slots;
+
+  // checks if two rows hold the same keys
+  bool sameKeys(size_t a, size_t b) const {
+    for (const Column* key : keys) {
+      if (key->compareRows(a, b) != 0) return false;
+    }
+    return true;
+  }
+
+  // doubles the number of slots and puts every group back
+  void grow() {
+    slots.assign(slots.size() * 2, 0);
+    size_t mask = slots.size() - 1;
+    for (size_t group = 0; group < firstRows.size(); group++) {
+      size_t s = hashes[group] & mask;
+      while (slots[s] != 0) s = (s + 1) & mask;
+      slots[s] = group + 1;
+    }
+  }
+};
+
+// combines the hashes of the keys at a row, mixing the bits so that hashes
+// that are small integers spread over every slot
+static size_t hashKeys(const vector<const Column*>& keys, size_t row) {
+  uint64_t hash = 0;
+  for (const Column* key : keys) {
+    hash = (hash ^ key->hashRow(row)) * 0x9e3779b97f4a7c15ULL;
+  }
+  return hash ^ (hash >> 32);
+}
+
+Table Table::groupBy(const vector<string>& keys,
+                     const vector<string>& values) {
+  TABLUZZY_TIME(groupByTimer);
+  // the groups hold positions, so pending deletions are applied first
+  compact();
+  // we resolve the columns once
+  vector<const Column*> keyColumns, valueColumns;
+  for (const string& header : keys) {
+    int index = findColumnIndex(header);
+    if (index == -1) throw runtime_error("no column with header " + header);
+    keyColumns.push_back(&data[index]);
+  }
+  if (keyColumns.empty()) throw runtime_error("no columns to group by");
+  for (const string& header : values) {
+    int index = findColumnIndex(header);
+    if (index == -1) throw runtime_error("no column with header " + header);
+    if (data[index].getValueType() != ValueType::flt) {
+      throw runtime_error("column " + header + " does not hold numbers");
+    }
+    valueColumns.push_back(&data[index]);
+  }
+  // without value columns every float column that is not a key is aggregated
+  if (values.empty()) {
+    for (const Column* col : getNumericalColumns()) {
+      if (find(keyColumns.begin(), keyColumns.end(), col) == keyColumns.end()) {
+        valueColumns.push_back(col);
+      }
+    }
+  }
+  size_t valueCount = valueColumns.size();
+
+  // every thread groups a run of rows into a table of its own
+  size_t threadCount = getThreadPool().getThreadCount();
+  size_t runs = max<size_t>(1, min(threadCount, rows / GROUP_CHUNK));
+  vector<GroupTable> partials(runs, GroupTable(keyColumns, valueCount));
+  getThreadPool().parallelFor(runs, [&](size_t r) {
+    GroupTable& partial = partials[r];
+    size_t first = rows * r / runs, last = rows * (r + 1) / runs;
+    for (size_t row = first; row < last; row++) {
+      size_t group = partial.find(row, hashKeys(keyColumns, row));
+      partial.counts[group]++;
+      Moments* groupMoments = &partial.moments[group * valueCount];
+      for (size_t v = 0; v < valueCount; v++) {
+        groupMoments[v].add(valueColumns[v]->getNumberAt(row), row);
+      }
+    }
+  });
+  TABLUZZY_COUNT(rowsScanned, size_t(rows) * (keys.size() + valueCount));
+
+  // the partial groups are merged in row order, so the groups keep the order
+  // they first appear in
+  GroupTable groups(keyColumns, valueCount);
+  for (const GroupTable& partial : partials) {
+    for (size_t g = 0; g < partial.firstRows.size(); g++) {
+      size_t group = groups.find(partial.firstRows[g], partial.hashes[g]);
+      groups.counts[group] += partial.counts[g];
+      for (size_t v = 0; v < valueCount; v++) {
+        groups.moments[group * valueCount + v].merge(
+            partial.moments[g * valueCount + v]);
+      }
+    }
+  }
+
+  // the keys of every group are copied from its first row, every header of
+  // the new table is numbered if it is already taken, as a key can be named
+  // count or like an aggregate
+  Table grouped;
+  for (const Column* key : keyColumns) {
+    grouped.addColumn(uniqueHeader(grouped, key->getHeader()),
+                      key->getValueType());
+    grouped.data.back().setStringEncoding(key->getStringEncoding());
+    grouped.data.back().appendRowsAt(*key, groups.firstRows);
+  }
+  grouped.addColumn(uniqueHeader(grouped, "count"), ValueType::flt);
+  for (size_t count : groups.counts) grouped.data.back().pushNumber(count);
+  // and the statistics of the values are derived from their moments the way
+  // the statistics of a whole column are
+  for (size_t v = 0; v < valueCount; v++) {
+    size_t first = grouped.data.size();
+    for (const char* suffix : AGGREGATE_SUFFIXES) {
+      grouped.addColumn(
+          uniqueHeader(grouped, valueColumns[v]->getHeader() + suffix),
+          ValueType::flt);
+    }
+    for (size_t group = 0; group < groups.counts.size(); group++) {
+      ColumnStats stats =
+          statsFromMoments(groups.moments[group * valueCount + v]);
+      grouped.data[first].pushNumber(stats.sum);
+      grouped.data[first + 1].pushNumber(stats.min);
+      grouped.data[first + 2].pushNumber(stats.max);
+      grouped.data[first + 3].pushNumber(stats.mean);
+      grouped.data[first + 4].pushNumber(stats.variance);
+    }
+  }
+  grouped.rows = groups.counts.size();
+  return grouped;
+}
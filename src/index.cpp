@@ -0,0 +1,251 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "index.hpp"
+
+using namespace std;
+
+void RowShifts::shift(size_t from, ptrdiff_t delta) {
+  // positions never decrease with the old rows, so the rows that move are
+  // the old rows from the first one now at from or after it on
+  size_t i = 0;
+  size_t first = from;
+  for (; i <= ranges.size(); i++) {
+    size_t begin = (i == 0) ? 0 : ranges[i - 1].first;
+    ptrdiff_t offset = (i == 0) ? 0 : ranges[i - 1].second;
+    first = max<ptrdiff_t>(begin, (ptrdiff_t)from - offset);
+    if (i == ranges.size() || first < ranges[i].first) break;
+  }
+  // the range holding that row is split there, and every range from it on
+  // moves by delta
+  if (i == 0 || ranges[i - 1].first != first) {
+    ptrdiff_t offset = (i == 0) ? 0 : ranges[i - 1].second;
+    ranges.insert(ranges.begin() + i, {first, offset});
+  } else {
+    i--;
+  }
+  for (size_t j = i; j < ranges.size(); j++) ranges[j].second += delta;
+  // ranges that end up with the offset of the range before them are merged
+  // into it, so an insert and a delete at the same row cancel out
+  size_t kept = 0;
+  for (size_t j = 0; j < ranges.size(); j++) {
+    ptrdiff_t previous = (kept == 0) ? 0 : ranges[kept - 1].second;
+    if (ranges[j].second != previous) ranges[kept++] = ranges[j];
+  }
+  ranges.resize(kept);
+};
+
+size_t RowShifts::apply(size_t row) const {
+  // the last range starting at the row or before it holds the row
+  auto after = upper_bound(
+      ranges.begin(), ranges.end(), row,
+      [](size_t r, const pair<size_t, ptrdiff_t>& range) {
+        return r < range.first;
+      });
+  if (after == ranges.begin()) return row;
+  return row + prev(after)->second;
+};
+
+bool RowShifts::invert(size_t position, size_t& row) const {
+  // the ranges are searched from the last one, which holds the latest rows
+  for (size_t i = ranges.size() + 1; i-- > 0;) {
+    size_t begin = (i == 0) ? 0 : ranges[i - 1].first;
+    size_t end = (i == ranges.size()) ? numeric_limits<size_t>::max()
+                                       : ranges[i].first;
+    ptrdiff_t offset = (i == 0) ? 0 : ranges[i - 1].second;
+    ptrdiff_t candidate = (ptrdiff_t)position - offset;
+    if (candidate >= (ptrdiff_t)begin && (size_t)candidate < end) {
+      row = candidate;
+      return true;
+    }
+  }
+  return false;
+};
+
+void StringIndex::build(size_t count,
+                        const function<string_view(size_t)>& valueAt) {
+  // we start from an empty index
+  clear();
+  // rows are visited in order, so every list of rows stays sorted
+  for (size_t row = 0; row < count; row++) insert(valueAt(row), row);
+};
+
+void StringIndex::add(string_view value, size_t row) {
+  // while rows wait to be moved, new rows are kept aside at their position
+  if (getPendingEdits() > 0) {
+    added.emplace_back(string(value), row);
+  } else {
+    insert(value, row);
+  }
+};
+
+void StringIndex::insert(string_view value, size_t row) {
+  // the key is only copied if the value is new to the index
+  auto found = rows.find(value);
+  if (found == rows.end()) {
+    found = rows.emplace(string(value), vector<size_t>()).first;
+  }
+  // appended rows go to the back, other rows to their sorted position
+  vector<size_t>& list = found->second;
+  list.insert(upper_bound(list.begin(), list.end(), row), row);
+};
+
+void StringIndex::remove(string_view value, size_t row) {
+  // a row added since the last flush is still kept aside
+  for (auto it = added.begin(); it != added.end(); it++) {
+    if (it->second == row && it->first == value) {
+      added.erase(it);
+      return;
+    }
+  }
+  // other rows are listed where they were before the pending moves
+  if (shifts.size() > 0 && !shifts.invert(row, row)) return;
+  auto found = rows.find(value);
+  if (found == rows.end()) return;
+  // we find the row in the sorted list and remove it
+  vector<size_t>& list = found->second;
+  auto at = lower_bound(list.begin(), list.end(), row);
+  if (at != list.end() && *at == row) list.erase(at);
+  // values that no row holds anymore leave the index
+  if (list.empty()) rows.erase(found);
+};
+
+int StringIndex::first(string_view value) const {
+  auto found = rows.find(value);
+  // the lists are sorted so the first row is at the front
+  return (found == rows.end()) ? -1 : found->second.front();
+};
+
+vector<size_t> StringIndex::all(string_view value) const {
+  auto found = rows.find(value);
+  if (found == rows.end()) return {};
+  return found->second;
+};
+
+void StringIndex::shift(size_t from, ptrdiff_t delta) {
+  // the listed rows move on the next flush, the rows kept aside right away
+  shifts.shift(from, delta);
+  for (auto& [value, row] : added) {
+    if (row >= from) row += delta;
+  }
+};
+
+void StringIndex::flush() {
+  if (getPendingEdits() == 0) return;
+  // the rows keep their order, so every list stays sorted
+  if (shifts.size() > 0) {
+    for (auto& [value, list] : rows) {
+      for (size_t& row : list) row = shifts.apply(row);
+    }
+  }
+  for (const auto& [value, row] : added) insert(value, row);
+  shifts.clear();
+  added.clear();
+};
+
+void StringIndex::clear() {
+  rows.clear();
+  shifts.clear();
+  added.clear();
+};
+
+void NumberIndex::build(const ChunkedVector<double>& values) {
+  clear();
+  // we collect every number that is not missing with its row
+  vector<Entry> sorted;
+  sorted.reserve(values.size());
+  size_t row = 0;
+  values.forEachChunk([&](span<const double> chunk) {
+    for (double value : chunk) {
+      if (!isnan(value)) sorted.push_back({value, row});
+      row++;
+    }
+  });
+  // sort them once and fill the set in order, which takes linear time
+  sort(sorted.begin(), sorted.end());
+  entries = set<Entry>(sorted.begin(), sorted.end());
+};
+
+void NumberIndex::add(double value, size_t row) {
+  // missing numbers never match, so they are not indexed
+  if (isnan(value)) return;
+  // while rows wait to be moved, new rows are kept aside at their position
+  if (getPendingEdits() > 0) {
+    added.push_back({value, row});
+  } else {
+    entries.insert({value, row});
+  }
+};
+
+void NumberIndex::remove(double value, size_t row) {
+  if (isnan(value)) return;
+  // a row added since the last flush is still kept aside
+  for (auto it = added.begin(); it != added.end(); it++) {
+    if (it->row == row && it->value == value) {
+      added.erase(it);
+      return;
+    }
+  }
+  // other rows are indexed where they were before the pending moves
+  if (shifts.size() > 0 && !shifts.invert(row, row)) return;
+  entries.erase({value, row});
+};
+
+int NumberIndex::first(double value) const {
+  // the smallest row with the value is the first entry not before it
+  auto found = entries.lower_bound({value, 0});
+  if (found == entries.end() || found->value != value) return -1;
+  return found->row;
+};
+
+vector<size_t> NumberIndex::all(double value) const {
+  // the rows with the value follow each other, in ascending order
+  vector<size_t> found;
+  for (auto it = entries.lower_bound({value, 0});
+       it != entries.end() && it->value == value; it++) {
+    found.push_back(it->row);
+  }
+  return found;
+};
+
+vector<size_t> NumberIndex::range(double low, double high) const {
+  vector<size_t> found;
+  // an empty or missing range matches nothing
+  if (!(low <= high)) return found;
+  // the entries between the bounds are ordered by value
+  auto last = entries.upper_bound({high, numeric_limits<size_t>::max()});
+  for (auto it = entries.lower_bound({low, 0}); it != last; it++) {
+    found.push_back(it->row);
+  }
+  // so we put their rows back in ascending order
+  sort(found.begin(), found.end());
+  return found;
+};
+
+void NumberIndex::shift(size_t from, ptrdiff_t delta) {
+  // the indexed rows move on the next flush, the rows kept aside right away
+  shifts.shift(from, delta);
+  for (Entry& entry : added) {
+    if (entry.row >= from) entry.row += delta;
+  }
+};
+
+void NumberIndex::flush() {
+  if (getPendingEdits() == 0) return;
+  // the moved rows keep their order among each other and stay after the rows
+  // before them, so the entries are changed in place and the set stays
+  // sorted
+  if (shifts.size() > 0) {
+    for (const Entry& entry : entries) entry.row = shifts.apply(entry.row);
+  }
+  entries.insert(added.begin(), added.end());
+  shifts.clear();
+  added.clear();
+};
+
+void NumberIndex::clear() {
+  entries.clear();
+  shifts.clear();
+  added.clear();
+};
@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+#include "tabluzzy.hpp"
+
+using namespace std;
+
+// the number of rows a thread hashes or probes at least before another
+// thread helps
+static const size_t JOIN_CHUNK = 1 << 16;
+
+// the hash table of a partition of the build rows, the entries holding the
+// same key are chained in ascending order of their rows
+struct JoinPartition {
+  // the build rows of the partition, in ascending order
+  vector<size_t> rows;
+  // the first entry of every key plus 1, 0 for an empty slot
+  vector<uint32_t> slots;
+  // the next entry holding the same key plus 1, 0 for the last one
+  vector<uint32_t> next;
+};
+
+// mixes the bits of a hash, so its high bits pick a partition and its low
+// bits a slot
+static uint64_t mixHash(uint64_t hash) {
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  return hash ^ (hash >> 33);
+}
+
+// checks if the key at a row can match, missing numbers never match
+static bool canMatch(const Column& key, size_t row) {
+  return key.getValueType() != ValueType::flt || !isnan(key.getNumberAt(row));
+}
+
+// checks if two rows of two key columns hold the same key
+static bool sameKey(const Column& a, size_t rowA, const Column& b,
+                    size_t rowB) {
+  if (a.getValueType() == ValueType::flt) {
+    return a.getNumberAt(rowA) == b.getNumberAt(rowB);
+  }
+  return a.getStringAt(rowA) == b.getStringAt(rowB);
+}
+
+// splits count rows into runs of at least JOIN_CHUNK rows, one per thread
+static size_t getRunCount(size_t count) {
+  return max<size_t>(1, min(getThreadCount(), count / JOIN_CHUNK));
+}
+
+Table Table::join(Table& other, const string& key, JoinType type) {
+  // both tables hold the key under the same header
+  return join(other, key, key, type);
+}
+
+Table Table::join(Table& other, const string& key, const string& otherKey,
+                  JoinType type) {
+  TABLUZZY_TIME(joinTimer);
+  // the matches hold positions, so pending deletions are applied first
+  compact();
+  other.compact();
+  int leftIndex = findColumnIndex(key);
+  int rightIndex = other.findColumnIndex(otherKey);
+  if (leftIndex == -1) throw runtime_error("no column with header " + key);
+  if (rightIndex == -1) {
+    throw runtime_error("no column with header " + otherKey);
+  }
+  const Column& leftKey = data[leftIndex];
+  const Column& rightKey = other.data[rightIndex];
+  if (leftKey.getValueType() != rightKey.getValueType()) {
+    throw runtime_error("key columns " + key + " and " + otherKey +
+                        " hold different datatypes");
+  }
+
+  // we build the hash tables on the smaller table and probe with the bigger
+  bool buildLeft = rows < other.rows;
+  const Column& buildKey = buildLeft ? leftKey : rightKey;
+  const Column& probeKey = buildLeft ? rightKey : leftKey;
+  size_t buildRows = buildLeft ? rows : other.rows;
+  size_t probeRows = buildLeft ? other.rows : rows;
+  vector<size_t> buildHashes = buildKey.getValueHashes();
+  vector<size_t> probeHashes = probeKey.getValueHashes();
+  for (size_t& hash : buildHashes) hash = mixHash(hash);
+  for (size_t& hash : probeHashes) hash = mixHash(hash);
+
+  // a big build side is split into a partition per thread by the high bits
+  // of the hashes, so the partitions are built in parallel
+  size_t partitionBits = 0;
+  if (buildRows >= JOIN_CHUNK) {
+    while ((size_t(1) << partitionBits) < getThreadCount()) partitionBits++;
+  }
+  size_t partitionCount = size_t(1) << partitionBits;
+  auto partitionOf = [partitionBits](uint64_t hash) {
+    return partitionBits ? hash >> (64 - partitionBits) : 0;
+  };
+  ThreadPool& pool = getThreadPool();
+  size_t buildRuns = getRunCount(buildRows);
+  vector<vector<vector<size_t>>> scattered(
+      buildRuns, vector<vector<size_t>>(partitionCount));
+  pool.parallelFor(buildRuns, [&](size_t r) {
+    size_t first = buildRows * r / buildRuns;
+    size_t last = buildRows * (r + 1) / buildRuns;
+    for (size_t row = first; row < last; row++) {
+      if (!canMatch(buildKey, row)) continue;
+      scattered[r][partitionOf(buildHashes[row])].push_back(row);
+    }
+  });
+
+  vector<JoinPartition> partitions(partitionCount);
+  pool.parallelFor(partitionCount, [&](size_t p) {
+    JoinPartition& partition = partitions[p];
+    // the runs are gathered in order so the rows stay ascending
+    for (size_t r = 0; r < buildRuns; r++) {
+      partition.rows.insert(partition.rows.end(), scattered[r][p].begin(),
+                            scattered[r][p].end());
+    }
+    // the table is kept at most half full so probes stay short
+    size_t slotCount = 16;
+    while (slotCount < partition.rows.size() * 2) slotCount *= 2;
+    partition.slots.assign(slotCount, 0);
+    partition.next.assign(partition.rows.size(), 0);
+    size_t mask = slotCount - 1;
+    // entries are added last to first, each in front of the entries with
+    // the same key, so the chains come out in ascending order
+    for (size_t e = partition.rows.size(); e-- > 0;) {
+      size_t row = partition.rows[e];
+      size_t s = buildHashes[row] & mask;
+      while (partition.slots[s] != 0) {
+        size_t head = partition.rows[partition.slots[s] - 1];
+        if (buildHashes[head] == buildHashes[row] &&
+            sameKey(buildKey, head, buildKey, row)) {
+          break;
+        }
+        s = (s + 1) & mask;
+      }
+      partition.next[e] = partition.slots[s];
+      partition.slots[s] = e + 1;
+    }
+  });
+
+  // every thread probes a run of rows, a match is kept as the pair of its
+  // left row and its right row
+  bool keepUnmatched = (type == leftJoin && !buildLeft);
+  size_t probeRuns = getRunCount(probeRows);
+  vector<vector<pair<size_t, size_t>>> matches(probeRuns);
+  pool.parallelFor(probeRuns, [&](size_t r) {
+    size_t first = probeRows * r / probeRuns;
+    size_t last = probeRows * (r + 1) / probeRuns;
+    for (size_t row = first; row < last; row++) {
+      size_t matched = matches[r].size();
+      if (canMatch(probeKey, row)) {
+        uint64_t hash = probeHashes[row];
+        const JoinPartition& partition = partitions[partitionOf(hash)];
+        size_t mask = partition.slots.size() - 1;
+        for (size_t s = hash & mask; partition.slots[s] != 0;
+             s = (s + 1) & mask) {
+          uint32_t entry = partition.slots[s];
+          size_t head = partition.rows[entry - 1];
+          if (buildHashes[head] != hash ||
+              !sameKey(probeKey, row, buildKey, head)) {
+            continue;
+          }
+          // every build row holding the key is a match
+          for (; entry != 0; entry = partition.next[entry - 1]) {
+            size_t buildRow = partition.rows[entry - 1];
+            if (buildLeft) {
+              matches[r].push_back({buildRow, row});
+            } else {
+              matches[r].push_back({row, buildRow});
+            }
+          }
+          break;
+        }
+      }
+      if (keepUnmatched && matches[r].size() == matched) {
+        matches[r].push_back({row, Column::MISSING_ROW});
+      }
+    }
+  });
+  TABLUZZY_COUNT(rowsScanned, buildRows + probeRows);
+
+  vector<pair<size_t, size_t>> pairs;
+  for (const auto& run : matches) {
+    pairs.insert(pairs.end(), run.begin(), run.end());
+  }
+  // matches probed from the right table are put back in left row order
+  if (buildLeft) sort(pairs.begin(), pairs.end());
+  vector<size_t> leftRows, rightRows;
+  leftRows.reserve(pairs.size());
+  rightRows.reserve(pairs.size());
+  if (buildLeft && type == leftJoin) {
+    size_t p = 0;
+    for (size_t row = 0; row < rows; row++) {
+      // a left row without matches is kept with a missing right row
+      if (p == pairs.size() || pairs[p].first != row) {
+        leftRows.push_back(row);
+        rightRows.push_back(Column::MISSING_ROW);
+      }
+      for (; p < pairs.size() && pairs[p].first == row; p++) {
+        leftRows.push_back(row);
+        rightRows.push_back(pairs[p].second);
+      }
+    }
+  } else {
+    for (auto [leftRow, rightRow] : pairs) {
+      leftRows.push_back(leftRow);
+      rightRows.push_back(rightRow);
+    }
+  }
+
+  // the new table has the columns of both tables, stored the same way
+  Table joined;
+  vector<pair<const Column*, const vector<size_t>*>> sources;
+  for (const Column& col : data) {
+    joined.addColumn(col.getHeader(), col.getValueType());
+    joined.data.back().setStringEncoding(col.getStringEncoding());
+    sources.push_back({&col, &leftRows});
+  }
+  for (const Column& col : other.data) {
+    if (&col == &rightKey) continue;
+    // a header already taken gets the suffix _right, numbered until it is
+    // unique as the suffixed header can be taken too
+    string header = col.getHeader();
+    if (joined.findColumnIndex(header) != -1) {
+      string suffixed = header + "_right";
+      for (int n = 2; joined.findColumnIndex(suffixed) != -1; n++) {
+        suffixed = header + "_right" + to_string(n);
+      }
+      header = move(suffixed);
+    }
+    joined.addColumn(header, col.getValueType());
+    joined.data.back().setStringEncoding(col.getStringEncoding());
+    sources.push_back({&col, &rightRows});
+  }
+  // and the rows of every match, gathered a column per task
+  pool.parallelFor(sources.size(), [&](size_t x) {
+    joined.data[x].appendRowsAt(*sources[x].first, *sources[x].second);
+  });
+  joined.rows = leftRows.size();
+  return joined;
+}
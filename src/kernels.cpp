@@ -0,0 +1,343 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include "kernels.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TABLUZZY_X86 1
+#endif
+
+using namespace std;
+
+// the numbers are reduced in blocks small enough to stay in the L1 cache
+// between the two passes over them
+static const size_t KERNEL_BLOCK = 2048;
+
+// the result of the first pass over a block
+struct BlockSums {
+  double sum, min, max;
+};
+
+// first pass of the scalar kernel, the sum, minimum and maximum of a block
+static BlockSums sumBlockScalar(const double* v, size_t n) {
+  // four independent sums so the additions can overlap
+  double s[4] = {0, 0, 0, 0};
+  double mn = v[0], mx = v[0];
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    for (size_t lane = 0; lane < 4; lane++) {
+      s[lane] += v[i + lane];
+      mn = min(mn, v[i + lane]);
+      mx = max(mx, v[i + lane]);
+    }
+  }
+  for (; i < n; i++) {
+    s[0] += v[i];
+    mn = min(mn, v[i]);
+    mx = max(mx, v[i]);
+  }
+  return {(s[0] + s[1]) + (s[2] + s[3]), mn, mx};
+}
+
+// second pass of the scalar kernel, the squared deviations of the values and
+// the products with the deviations x0, x0 + 1, ... of the row indexes
+static void deviationBlockScalar(const double* v, size_t n, double mean,
+                                 double x0, double& m2, double& cxy) {
+  double sq = 0, cross = 0;
+  for (size_t i = 0; i < n; i++) {
+    double d = v[i] - mean;
+    sq += d * d;
+    cross += (x0 + i) * d;
+  }
+  m2 = sq;
+  cxy = cross;
+}
+
+// the moments of a block holding missing numbers (NaN), which are left out,
+// x0 is the row index of the first number
+static Moments momentsBlockMissing(const double* v, size_t n, double x0) {
+  Moments moments;
+  double sum = 0, sumX = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (isnan(v[i])) continue;
+    moments.count++;
+    sum += v[i];
+    sumX += x0 + i;
+    moments.min = min(moments.min, v[i]);
+    moments.max = max(moments.max, v[i]);
+  }
+  if (moments.count == 0) return moments;
+  moments.sum = sum;
+  moments.mean = sum / moments.count;
+  moments.meanX = sumX / moments.count;
+  // the row indexes are no longer consecutive, so their moments are summed
+  // like the moments of the values
+  for (size_t i = 0; i < n; i++) {
+    if (isnan(v[i])) continue;
+    double d = v[i] - moments.mean, dx = x0 + i - moments.meanX;
+    moments.m2 += d * d;
+    moments.m2x += dx * dx;
+    moments.cxy += dx * d;
+  }
+  return moments;
+}
+
+#ifdef TABLUZZY_X86
+// first pass of the AVX2 kernel
+__attribute__((target("avx2,fma"))) static BlockSums sumBlockAvx2(
+    const double* v, size_t n) {
+  if (n < 8) return sumBlockScalar(v, n);
+  __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+  __m256d mn = _mm256_set1_pd(v[0]), mx = mn;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256d a = _mm256_loadu_pd(v + i), b = _mm256_loadu_pd(v + i + 4);
+    s0 = _mm256_add_pd(s0, a);
+    s1 = _mm256_add_pd(s1, b);
+    mn = _mm256_min_pd(mn, _mm256_min_pd(a, b));
+    mx = _mm256_max_pd(mx, _mm256_max_pd(a, b));
+  }
+  alignas(32) double s[4], lo[4], hi[4];
+  _mm256_store_pd(s, _mm256_add_pd(s0, s1));
+  _mm256_store_pd(lo, mn);
+  _mm256_store_pd(hi, mx);
+  BlockSums sums = {(s[0] + s[1]) + (s[2] + s[3]),
+                    min(min(lo[0], lo[1]), min(lo[2], lo[3])),
+                    max(max(hi[0], hi[1]), max(hi[2], hi[3]))};
+  // the tail is reduced with the scalar kernel
+  if (i < n) {
+    BlockSums tail = sumBlockScalar(v + i, n - i);
+    sums.sum += tail.sum;
+    sums.min = min(sums.min, tail.min);
+    sums.max = max(sums.max, tail.max);
+  }
+  return sums;
+}
+
+// second pass of the AVX2 kernel
+__attribute__((target("avx2,fma"))) static void deviationBlockAvx2(
+    const double* v, size_t n, double mean, double x0, double& m2,
+    double& cxy) {
+  __m256d meanV = _mm256_set1_pd(mean), step = _mm256_set1_pd(4);
+  __m256d x = _mm256_setr_pd(x0, x0 + 1, x0 + 2, x0 + 3);
+  __m256d sq = _mm256_setzero_pd(), cross = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d d = _mm256_sub_pd(_mm256_loadu_pd(v + i), meanV);
+    sq = _mm256_fmadd_pd(d, d, sq);
+    cross = _mm256_fmadd_pd(x, d, cross);
+    x = _mm256_add_pd(x, step);
+  }
+  alignas(32) double a[4], b[4];
+  _mm256_store_pd(a, sq);
+  _mm256_store_pd(b, cross);
+  double tailSq = 0, tailCross = 0;
+  if (i < n) {
+    deviationBlockScalar(v + i, n - i, mean, x0 + i, tailSq, tailCross);
+  }
+  m2 = (a[0] + a[1]) + (a[2] + a[3]) + tailSq;
+  cxy = (b[0] + b[1]) + (b[2] + b[3]) + tailCross;
+}
+
+// first pass of the AVX-512 kernel
+__attribute__((target("avx512f"))) static BlockSums sumBlockAvx512(
+    const double* v, size_t n) {
+  if (n < 16) return sumBlockScalar(v, n);
+  __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+  __m512d mn = _mm512_set1_pd(v[0]), mx = mn;
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512d a = _mm512_loadu_pd(v + i), b = _mm512_loadu_pd(v + i + 8);
+    s0 = _mm512_add_pd(s0, a);
+    s1 = _mm512_add_pd(s1, b);
+    mn = _mm512_min_pd(mn, _mm512_min_pd(a, b));
+    mx = _mm512_max_pd(mx, _mm512_max_pd(a, b));
+  }
+  BlockSums sums = {_mm512_reduce_add_pd(_mm512_add_pd(s0, s1)),
+                    _mm512_reduce_min_pd(mn), _mm512_reduce_max_pd(mx)};
+  // the tail is reduced with the scalar kernel
+  if (i < n) {
+    BlockSums tail = sumBlockScalar(v + i, n - i);
+    sums.sum += tail.sum;
+    sums.min = min(sums.min, tail.min);
+    sums.max = max(sums.max, tail.max);
+  }
+  return sums;
+}
+
+// second pass of the AVX-512 kernel
+__attribute__((target("avx512f"))) static void deviationBlockAvx512(
+    const double* v, size_t n, double mean, double x0, double& m2,
+    double& cxy) {
+  __m512d meanV = _mm512_set1_pd(mean), step = _mm512_set1_pd(8);
+  __m512d x = _mm512_add_pd(_mm512_set1_pd(x0),
+                            _mm512_setr_pd(0, 1, 2, 3, 4, 5, 6, 7));
+  __m512d sq = _mm512_setzero_pd(), cross = _mm512_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512d d = _mm512_sub_pd(_mm512_loadu_pd(v + i), meanV);
+    sq = _mm512_fmadd_pd(d, d, sq);
+    cross = _mm512_fmadd_pd(x, d, cross);
+    x = _mm512_add_pd(x, step);
+  }
+  double tailSq = 0, tailCross = 0;
+  if (i < n) {
+    deviationBlockScalar(v + i, n - i, mean, x0 + i, tailSq, tailCross);
+  }
+  m2 = _mm512_reduce_add_pd(sq) + tailSq;
+  cxy = _mm512_reduce_add_pd(cross) + tailCross;
+}
+#endif
+
+// the best instruction set the processor supports
+static SimdLevel detectSimdLevel() {
+#ifdef TABLUZZY_X86
+  if (__builtin_cpu_supports("avx512f")) return avx512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return avx2;
+  }
+#endif
+  return noSimd;
+}
+
+// the instruction set the kernels run with, detected once at start up
+static atomic<int> simdLevel{detectSimdLevel()};
+
+SimdLevel getSimdLevel() {
+  // returns the current instruction set
+  return static_cast<SimdLevel>(simdLevel.load(memory_order_relaxed));
+}
+
+void setSimdLevel(SimdLevel level) {
+  // we never select more than the processor supports
+  simdLevel.store(min(level, detectSimdLevel()), memory_order_relaxed);
+}
+
+void Moments::merge(const Moments& other) {
+  // merging with an empty block changes nothing
+  if (other.count == 0) return;
+  if (count == 0) {
+    *this = other;
+    return;
+  }
+  // the pairwise update of Chan et al. for the means and sums of squares
+  double n = double(count) + other.count;
+  double weight = double(count) * other.count / n;
+  double dy = other.mean - mean, dx = other.meanX - meanX;
+  m2 += other.m2 + dy * dy * weight;
+  m2x += other.m2x + dx * dx * weight;
+  cxy += other.cxy + dx * dy * weight;
+  mean += dy * other.count / n;
+  meanX += dx * other.count / n;
+
+  // the sums are added with Neumaier's compensation
+  double total = sum + other.sum;
+  if (fabs(sum) >= fabs(other.sum)) {
+    compensation += (sum - total) + other.sum;
+  } else {
+    compensation += (other.sum - total) + sum;
+  }
+  compensation += other.compensation;
+  sum = total;
+
+  min = std::min(min, other.min);
+  max = std::max(max, other.max);
+  count += other.count;
+}
+
+void Moments::add(double value, size_t row) {
+  if (isnan(value)) return;
+  // the running update of Welford for the means and sums of squares
+  count++;
+  double dx = row - meanX, dy = value - mean;
+  meanX += dx / count;
+  mean += dy / count;
+  m2 += dy * (value - mean);
+  m2x += dx * (row - meanX);
+  cxy += dx * (value - mean);
+
+  // the sum is added with Neumaier's compensation
+  double total = sum + value;
+  if (fabs(sum) >= fabs(value)) {
+    compensation += (sum - total) + value;
+  } else {
+    compensation += (value - total) + sum;
+  }
+  sum = total;
+
+  min = std::min(min, value);
+  max = std::max(max, value);
+}
+
+Moments computeMoments(const double* values, size_t count, size_t firstRow) {
+  // we pick the kernels once for the whole call
+  BlockSums (*sumBlock)(const double*, size_t) = sumBlockScalar;
+  void (*deviationBlock)(const double*, size_t, double, double, double&,
+                         double&) = deviationBlockScalar;
+#ifdef TABLUZZY_X86
+  switch (getSimdLevel()) {
+    case avx512:
+      sumBlock = sumBlockAvx512;
+      deviationBlock = deviationBlockAvx512;
+      break;
+    case avx2:
+      sumBlock = sumBlockAvx2;
+      deviationBlock = deviationBlockAvx2;
+      break;
+    default:
+      break;
+  }
+#endif
+
+  Moments total;
+  for (size_t offset = 0; offset < count; offset += KERNEL_BLOCK) {
+    size_t n = min(KERNEL_BLOCK, count - offset);
+    const double* block = values + offset;
+    // the first pass gives the mean of the block
+    BlockSums sums = sumBlock(block, n);
+    // a missing number turns the sum into NaN, and the rare blocks holding
+    // one are reduced again without them
+    if (isnan(sums.sum)) {
+      total.merge(momentsBlockMissing(block, n, double(firstRow + offset)));
+      continue;
+    }
+    Moments moments;
+    moments.count = n;
+    moments.sum = sums.sum;
+    moments.min = sums.min;
+    moments.max = sums.max;
+    moments.mean = sums.sum / n;
+    // the row indexes of the block are consecutive, so their moments have a
+    // closed form
+    double half = (double(n) - 1) / 2;
+    moments.meanX = firstRow + offset + half;
+    moments.m2x = (double(n) * n * n - n) / 12;
+    // the second pass sums the deviations from the means
+    deviationBlock(block, n, moments.mean, -half, moments.m2, moments.cxy);
+    // and the block is merged into the total
+    total.merge(moments);
+  }
+  return total;
+}
+
+double selectMedian(vector<double>& values) {
+  // missing numbers have no place in the order
+  values.erase(remove_if(values.begin(), values.end(),
+                         [](double value) { return isnan(value); }),
+               values.end());
+  // there is no median of no values
+  if (values.empty()) return numeric_limits<double>::quiet_NaN();
+  // we select the middle value instead of sorting every value
+  size_t middle = values.size() / 2;
+  nth_element(values.begin(), values.begin() + middle, values.end());
+  double median = values[middle];
+  // for an even count the other middle value is the biggest value of the
+  // lower half
+  if (values.size() % 2 == 0) {
+    double lower = *max_element(values.begin(), values.begin() + middle);
+    median = (lower + median) / 2;
+  }
+  return median;
+}
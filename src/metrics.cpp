@@ -0,0 +1,137 @@
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "metrics.hpp"
+
+using namespace std;
+
+// the names of the timers and counters in the json of the metrics
+static const char* TIMER_NAMES[TIMER_COUNT] = {
+    "csvLoad", "csvExport",  "htmlExport", "display", "sort",
+    "statistics", "snapshot", "filter", "groupBy", "join"};
+static const char* COUNTER_NAMES[COUNTER_COUNT] = {
+    "bytesAllocated", "rowsScanned", "numberConversions", "columnCopies"};
+
+// the timers and counters of one thread, only the thread itself adds to them
+// so adding never contends with other threads
+struct MetricSlots {
+  atomic<uint64_t> calls[TIMER_COUNT] = {};
+  atomic<uint64_t> nanoseconds[TIMER_COUNT] = {};
+  atomic<uint64_t> counters[COUNTER_COUNT] = {};
+
+  // adds the slots to metrics
+  void addTo(Metrics& metrics) const {
+    for (size_t t = 0; t < TIMER_COUNT; t++) {
+      metrics.timers[t].calls += calls[t].load(memory_order_relaxed);
+      metrics.timers[t].nanoseconds +=
+          nanoseconds[t].load(memory_order_relaxed);
+    }
+    for (size_t c = 0; c < COUNTER_COUNT; c++) {
+      metrics.counters[c] += counters[c].load(memory_order_relaxed);
+    }
+  }
+
+  // sets the slots back to zero
+  void reset() {
+    for (auto& value : calls) value.store(0, memory_order_relaxed);
+    for (auto& value : nanoseconds) value.store(0, memory_order_relaxed);
+    for (auto& value : counters) value.store(0, memory_order_relaxed);
+  }
+};
+
+// the slots of every running thread, and the sum of the slots of the threads
+// that have exited
+struct MetricRegistry {
+  mutex lock;
+  vector<MetricSlots*> live;
+  MetricSlots exited;
+};
+
+// the registry is never destroyed, so threads exiting at shutdown can still
+// hand their slots over
+static MetricRegistry& getRegistry() {
+  static MetricRegistry* registry = new MetricRegistry();
+  return *registry;
+}
+
+// registers the slots of a thread for as long as the thread runs
+struct ThreadSlots {
+  MetricSlots slots;
+
+  ThreadSlots() {
+    MetricRegistry& registry = getRegistry();
+    lock_guard<mutex> guard(registry.lock);
+    registry.live.push_back(&slots);
+  }
+
+  ~ThreadSlots() {
+    MetricRegistry& registry = getRegistry();
+    lock_guard<mutex> guard(registry.lock);
+    // what the thread counted is kept after it exits
+    Metrics counted;
+    slots.addTo(counted);
+    for (size_t t = 0; t < TIMER_COUNT; t++) {
+      registry.exited.calls[t] += counted.timers[t].calls;
+      registry.exited.nanoseconds[t] += counted.timers[t].nanoseconds;
+    }
+    for (size_t c = 0; c < COUNTER_COUNT; c++) {
+      registry.exited.counters[c] += counted.counters[c];
+    }
+    erase(registry.live, &slots);
+  }
+};
+
+// gets the slots of the calling thread
+static MetricSlots& getThreadSlots() {
+  thread_local ThreadSlots thread;
+  return thread.slots;
+}
+
+string Metrics::to_json() const {
+  string json = "{\"enabled\":";
+  json += enabled ? "true" : "false";
+  json += ",\"timers\":{";
+  for (size_t t = 0; t < TIMER_COUNT; t++) {
+    if (t > 0) json += ",";
+    json += "\"" + string(TIMER_NAMES[t]) + "\":{\"calls\":" +
+            to_string(timers[t].calls) +
+            ",\"nanoseconds\":" + to_string(timers[t].nanoseconds) + "}";
+  }
+  json += "},\"counters\":{";
+  for (size_t c = 0; c < COUNTER_COUNT; c++) {
+    if (c > 0) json += ",";
+    json += "\"" + string(COUNTER_NAMES[c]) + "\":" + to_string(counters[c]);
+  }
+  json += "}}";
+  return json;
+}
+
+Metrics getMetrics() {
+  Metrics metrics;
+#ifdef TABLUZZY_METRICS
+  metrics.enabled = true;
+  MetricRegistry& registry = getRegistry();
+  lock_guard<mutex> guard(registry.lock);
+  registry.exited.addTo(metrics);
+  for (const MetricSlots* slots : registry.live) slots->addTo(metrics);
+#endif
+  return metrics;
+}
+
+void resetMetrics() {
+  MetricRegistry& registry = getRegistry();
+  lock_guard<mutex> guard(registry.lock);
+  registry.exited.reset();
+  for (MetricSlots* slots : registry.live) slots->reset();
+}
+
+void addToCounter(MetricCounter counter, uint64_t amount) {
+  getThreadSlots().counters[counter].fetch_add(amount, memory_order_relaxed);
+}
+
+void addToTimer(MetricTimer timer, uint64_t nanoseconds) {
+  MetricSlots& slots = getThreadSlots();
+  slots.calls[timer].fetch_add(1, memory_order_relaxed);
+  slots.nanoseconds[timer].fetch_add(nanoseconds, memory_order_relaxed);
+}
@@ -0,0 +1,65 @@
+#include <charconv>
+#include <cmath>
+#include <limits>
+
+#include "metrics.hpp"
+#include "numbers.hpp"
+
+using namespace std;
+
+// the characters allowed around a number
+static const char* BLANKS = " \t\r\n";
+
+ParseStatus parseNumber(string_view text, double& value) {
+  TABLUZZY_COUNT(numberConversions, 1);
+  // blanks around the number are ignored, text of nothing but blanks is a
+  // missing number
+  if (!text.empty() && (text.front() <= ' ' || text.back() <= ' ')) {
+    size_t first = text.find_first_not_of(BLANKS);
+    if (first == string_view::npos) text = {};
+    else text = text.substr(first, text.find_last_not_of(BLANKS) - first + 1);
+  }
+  if (text.empty()) {
+    value = numeric_limits<double>::quiet_NaN();
+    return nullNumber;
+  }
+  // from_chars does not take a plus sign, so we skip it
+  if (text.front() == '+') {
+    text.remove_prefix(1);
+    if (text.empty() || text.front() == '-' || text.front() == '+') {
+      value = numeric_limits<double>::quiet_NaN();
+      return invalidNumber;
+    }
+  }
+  const char* end = text.data() + text.size();
+  auto [stop, error] = from_chars(text.data(), end, value);
+  // every character has to be part of the number
+  if (error != errc() || stop != end) {
+    value = numeric_limits<double>::quiet_NaN();
+    return invalidNumber;
+  }
+  // nan is how a missing number is written
+  return isnan(value) ? nullNumber : parsedNumber;
+}
+
+bool parseCount(string_view text, size_t& count) {
+  size_t first = text.find_first_not_of(BLANKS);
+  if (first == string_view::npos) return false;
+  text = text.substr(first, text.find_last_not_of(BLANKS) - first + 1);
+  const char* end = text.data() + text.size();
+  auto [stop, error] = from_chars(text.data(), end, count);
+  return error == errc() && stop == end;
+}
+
+size_t formatNumber(double value, char* buffer) {
+  TABLUZZY_COUNT(numberConversions, 1);
+  // a missing number is written as nothing, so it reads back as missing
+  if (isnan(value)) return 0;
+  // without a precision to_chars writes the shortest text that round trips
+  return to_chars(buffer, buffer + NUMBER_BUFFER_SIZE, value).ptr - buffer;
+}
+
+string formatNumber(double value) {
+  char buffer[NUMBER_BUFFER_SIZE];
+  return string(buffer, formatNumber(value, buffer));
+}
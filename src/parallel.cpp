@@ -0,0 +1,121 @@
+#include "parallel.hpp"
+
+using namespace std;
+
+ThreadPool::ThreadPool(size_t count) {
+  // there is always at least the calling thread
+  threadCount = (count == 0) ? 1 : count;
+  // the calling thread works on its own jobs, so we start one less worker
+  for (size_t i = 1; i < threadCount; i++) {
+    workers.emplace_back([this] { work(); });
+  }
+};
+
+ThreadPool::~ThreadPool() {
+  // we tell every worker to stop and wait for them
+  {
+    lock_guard<mutex> guard(lock);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (thread& worker : workers) worker.join();
+};
+
+size_t ThreadPool::getThreadCount() const {
+  // returns the number of threads working on every job
+  return threadCount;
+};
+
+void ThreadPool::runJob(Job& job) {
+  // we take indexes until every index has been handed out
+  for (size_t i = job.next++; i < job.count; i = job.next++) {
+    try {
+      (*job.task)(i);
+    } catch (...) {
+      // we keep the first exception for the caller
+      lock_guard<mutex> guard(lock);
+      if (!job.error) job.error = current_exception();
+    }
+    // whoever finishes the last index wakes the caller
+    if (++job.finished == job.count) {
+      lock_guard<mutex> guard(lock);
+      done.notify_all();
+    }
+  }
+};
+
+void ThreadPool::work() {
+  while (true) {
+    shared_ptr<Job> job;
+    {
+      unique_lock<mutex> guard(lock);
+      wake.wait(guard, [this] { return stopping || !jobs.empty(); });
+      if (stopping) return;
+      // jobs that handed out every index are dropped from the queue
+      if (jobs.front()->next >= jobs.front()->count) {
+        jobs.pop_front();
+        continue;
+      }
+      job = jobs.front();
+    }
+    runJob(*job);
+  }
+};
+
+void ThreadPool::parallelFor(size_t count, const function<void(size_t)>& task) {
+  if (count == 0) return;
+  // with a single thread or a single task there is nothing to share
+  if (threadCount == 1 || count == 1) {
+    for (size_t i = 0; i < count; i++) task(i);
+    return;
+  }
+
+  auto job = make_shared<Job>();
+  job->count = count;
+  job->task = &task;
+  {
+    lock_guard<mutex> guard(lock);
+    jobs.push_back(job);
+  }
+  wake.notify_all();
+
+  // the calling thread works on the job as well
+  runJob(*job);
+  {
+    unique_lock<mutex> guard(lock);
+    done.wait(guard, [&job] { return job->finished == job->count; });
+    // the job may still be queued if the workers never got to it
+    for (auto it = jobs.begin(); it != jobs.end(); it++) {
+      if (*it == job) {
+        jobs.erase(it);
+        break;
+      }
+    }
+  }
+  if (job->error) rethrow_exception(job->error);
+};
+
+// the pool shared by the library and the lock that guards replacing it
+static unique_ptr<ThreadPool> sharedPool;
+static mutex sharedPoolLock;
+
+ThreadPool& getThreadPool() {
+  lock_guard<mutex> guard(sharedPoolLock);
+  // the pool is created the first time it is needed
+  if (!sharedPool) {
+    sharedPool = make_unique<ThreadPool>(thread::hardware_concurrency());
+  }
+  return *sharedPool;
+};
+
+void setThreadCount(size_t threadCount) {
+  if (threadCount == 0) threadCount = thread::hardware_concurrency();
+  lock_guard<mutex> guard(sharedPoolLock);
+  // the old pool joins its workers when it is replaced
+  sharedPool = make_unique<ThreadPool>(threadCount);
+};
+
+size_t getThreadCount() {
+  // returns the number of threads of the shared pool
+  return getThreadPool().getThreadCount();
+};
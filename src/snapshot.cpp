@@ -0,0 +1,329 @@
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+
+#include "mapping.hpp"
+#include "tabluzzy.hpp"
+
+using namespace std;
+
+// Layout of a snapshot file, every number is stored in the byte order of the
+// machine that wrote it and every buffer starts at a multiple of
+// SNAPSHOT_ALIGNMENT. The rows are never read at load time so that only the
+// pages that are used get faulted in, which means the bounds of every buffer
+// are checked but the codes and string locations of the rows are trusted:
+//   a SnapshotHeader
+//   the buffers of every column
+//   a SnapshotColumn for every column, followed by the bytes of the headers
+
+// the first bytes of every snapshot file
+static const char SNAPSHOT_MAGIC[8] = {'T', 'B', 'L', 'Z', 'S', 'N', 'A', 'P'};
+// written as a number so a file from a machine with another byte order is
+// recognized
+static const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+// the version of the layout
+static const uint32_t SNAPSHOT_VERSION = 1;
+// the alignment of every buffer in the file
+static const uint64_t SNAPSHOT_ALIGNMENT = 64;
+// the biggest segment of string bytes, so offsets into a segment fit in a
+// StrRef
+static const uint64_t SNAPSHOT_SEGMENT_SIZE = 1 << 30;
+
+// the row locations are stored in the file as they are
+static_assert(sizeof(StrRef) == 12, "StrRef must not be padded");
+
+/// @brief the start of a snapshot file
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t byteOrder;
+  uint32_t version;
+  // the number of columns and rows of the table
+  uint64_t columnCount;
+  uint64_t rowCount;
+  // the position of the column descriptions
+  uint64_t directoryOffset;
+};
+
+/// @brief the description of a column in a snapshot file
+struct SnapshotColumn {
+  // the datatype and string encoding of the column
+  uint32_t type;
+  uint32_t encoding;
+  // the position and length of the header of the column
+  uint64_t headerOffset;
+  uint64_t headerLength;
+  // the values of the rows, numbers for a float column, StrRefs for a plain
+  // string column and dictionary codes for an encoded one
+  uint64_t valuesOffset;
+  // the StrRefs of the dictionary values of an encoded column
+  uint64_t refsOffset;
+  uint64_t refsCount;
+  // the positions bounding every segment of string bytes, segmentCount + 1
+  // of them
+  uint64_t segmentsOffset;
+  uint64_t segmentCount;
+};
+
+/// @brief Class that writes tables to and reads tables from snapshot files,
+/// a friend of both Table and Column
+class Snapshot {
+ public:
+  /// @brief writes every row and column of table to the file at path
+  static void write(Table& table, const string& path) {
+    TABLUZZY_TIME(snapshotTimer);
+    // rows pending deletion are never written
+    table.compact();
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out) throw runtime_error("could not create snapshot file " + path);
+    Snapshot writer(out);
+
+    // the header is written again at the end, once the directory is placed
+    SnapshotHeader header = {};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.version = SNAPSHOT_VERSION;
+    header.columnCount = table.data.size();
+    header.rowCount = table.rows;
+    writer.put(&header, sizeof(header));
+
+    vector<SnapshotColumn> directory;
+    for (const Column& col : table.data) {
+      directory.push_back(writer.writeColumn(col, table.rows));
+    }
+    // the headers follow the directory
+    writer.align();
+    header.directoryOffset = writer.position;
+    uint64_t headerOffset =
+        writer.position + directory.size() * sizeof(SnapshotColumn);
+    for (size_t x = 0; x < directory.size(); x++) {
+      directory[x].headerOffset = headerOffset;
+      directory[x].headerLength = table.data[x].getHeader().size();
+      headerOffset += directory[x].headerLength;
+    }
+    writer.put(directory.data(), directory.size() * sizeof(SnapshotColumn));
+    for (const Column& col : table.data) {
+      writer.put(col.getHeader().data(), col.getHeader().size());
+    }
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!out) throw runtime_error("could not write snapshot file " + path);
+  }
+
+  /// @brief replaces the content of table with the snapshot file at path
+  static void read(Table& table, const string& path) {
+    TABLUZZY_TIME(snapshotTimer);
+    const char* bytes = nullptr;
+    size_t size = 0;
+    shared_ptr<const void> owner;
+#ifdef TABLUZZY_HAS_MMAP
+    // the file is mapped, so nothing is read until a page is touched
+    auto mapping = make_shared<MappedFile>(path);
+    bytes = mapping->bytes;
+    size = mapping->size;
+    owner = mapping;
+#endif
+    if (!bytes) {
+      // if the file could not be mapped we read it into memory instead
+      ifstream in(path, ios::binary | ios::ate);
+      if (!in) throw runtime_error("could not open snapshot file " + path);
+      auto buffer = make_shared<vector<char>>(size_t(in.tellg()));
+      in.seekg(0);
+      in.read(buffer->data(), buffer->size());
+      bytes = buffer->data();
+      size = buffer->size();
+      owner = buffer;
+    }
+    Snapshot reader(path, bytes, size);
+
+    const SnapshotHeader& header = reader.at<SnapshotHeader>(0, 1);
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.byteOrder != SNAPSHOT_BYTE_ORDER ||
+        header.version != SNAPSHOT_VERSION) {
+      reader.fail();
+    }
+    const SnapshotColumn* directory = &reader.at<SnapshotColumn>(
+        header.directoryOffset, header.columnCount);
+
+    table.flushTable();
+    for (size_t x = 0; x < header.columnCount; x++) {
+      const SnapshotColumn& entry = directory[x];
+      const char* text = &reader.at<char>(entry.headerOffset,
+                                          entry.headerLength);
+      ValueType dttype =
+          (entry.type == ValueType::flt) ? ValueType::flt : ValueType::str;
+      table.addColumn(string(text, entry.headerLength), dttype);
+      reader.readColumn(table.data.back(), entry, header.rowCount, owner);
+    }
+    table.rows = header.rowCount;
+  }
+
+ private:
+  // the file being written
+  ofstream* out = nullptr;
+  // the position in the file being written
+  uint64_t position = 0;
+  // the path, bytes and size of the file being read
+  string path;
+  const char* bytes = nullptr;
+  size_t size = 0;
+
+  Snapshot(ofstream& file) : out(&file) {}
+  Snapshot(const string& file, const char* data, size_t length)
+      : path(file), bytes(data), size(length) {}
+
+  // appends bytes to the file
+  void put(const void* data, size_t length) {
+    out->write(static_cast<const char*>(data), length);
+    position += length;
+  }
+
+  // pads the file up to the next buffer boundary
+  void align() {
+    static const char padding[SNAPSHOT_ALIGNMENT] = {};
+    size_t gap = (SNAPSHOT_ALIGNMENT - position % SNAPSHOT_ALIGNMENT) %
+                 SNAPSHOT_ALIGNMENT;
+    put(padding, gap);
+  }
+
+  // writes every chunk of a chunked vector as one contiguous buffer
+  template <typename T>
+  uint64_t putValues(const ChunkedVector<T>& values) {
+    align();
+    uint64_t offset = position;
+    values.forEachChunk([this](span<const T> chunk) {
+      put(chunk.data(), chunk.size_bytes());
+    });
+    return offset;
+  }
+
+  // writes strings into segments of bytes, and returns where every string
+  // ended up
+  vector<StrRef> putStrings(SnapshotColumn& entry, size_t count,
+                            const function<string_view(size_t)>& valueAt) {
+    vector<StrRef> refs(count);
+    vector<uint64_t> bounds;
+    align();
+    bounds.push_back(position);
+    for (size_t i = 0; i < count; i++) {
+      string_view value = valueAt(i);
+      // a string that does not fit in the current segment starts a new one
+      if (position - bounds.back() + value.size() > SNAPSHOT_SEGMENT_SIZE &&
+          position != bounds.back()) {
+        bounds.push_back(position);
+      }
+      refs[i].block = bounds.size() - 1;
+      refs[i].offset = position - bounds.back();
+      refs[i].length = value.size();
+      put(value.data(), value.size());
+    }
+    bounds.push_back(position);
+    // the bounds of the segments are written after them
+    align();
+    entry.segmentsOffset = position;
+    entry.segmentCount = bounds.size() - 1;
+    put(bounds.data(), bounds.size() * sizeof(uint64_t));
+    return refs;
+  }
+
+  // writes the buffers of a column and describes them
+  SnapshotColumn writeColumn(const Column& col, size_t rowCount) {
+    SnapshotColumn entry = {};
+    entry.type = col.getValueType();
+    entry.encoding = col.getStringEncoding();
+    if (col.type == ValueType::flt) {
+      entry.valuesOffset = putValues(col.numbers);
+    } else if (col.encoded) {
+      // the codes are written as they are and the dictionary as strings
+      entry.valuesOffset = putValues(col.codes);
+      const Dictionary& dictionary = *col.dictionary;
+      vector<StrRef> refs =
+          putStrings(entry, dictionary.size(),
+                     [&](size_t code) { return dictionary.decode(code); });
+      align();
+      entry.refsOffset = position;
+      entry.refsCount = refs.size();
+      put(refs.data(), refs.size() * sizeof(StrRef));
+    } else {
+      // the strings are packed in row order, then located
+      vector<StrRef> refs = putStrings(
+          entry, rowCount, [&](size_t row) { return col.getStringAt(row); });
+      align();
+      entry.valuesOffset = position;
+      put(refs.data(), refs.size() * sizeof(StrRef));
+    }
+    return entry;
+  }
+
+  // reports a file that is not a valid snapshot
+  [[noreturn]] void fail() const {
+    throw runtime_error("invalid snapshot file " + path);
+  }
+
+  // gets count values of type T at offset in the file being read, checking
+  // they are inside of the file and aligned
+  template <typename T>
+  const T& at(uint64_t offset, uint64_t count) const {
+    if (offset > size || count > (size - offset) / sizeof(T) ||
+        offset % alignof(T) != 0) {
+      fail();
+    }
+    return *reinterpret_cast<const T*>(bytes + offset);
+  }
+
+  // points a column at its buffers in the file being read
+  void readColumn(Column& col, const SnapshotColumn& entry, uint64_t rowCount,
+                  const shared_ptr<const void>& owner) {
+    if (entry.type == ValueType::flt) {
+      // the numbers are borrowed from the file
+      const double* numbers = &at<double>(entry.valuesOffset, rowCount);
+      col.numbers.appendBorrowed(span<const double>(numbers, rowCount), owner);
+      return;
+    }
+    // the segments of string bytes become borrowed blocks of the arena or
+    // of a staging arena for the dictionary
+    const uint64_t* bounds =
+        &at<uint64_t>(entry.segmentsOffset, entry.segmentCount + 1);
+    StringArena arena;
+    for (size_t s = 0; s < entry.segmentCount; s++) {
+      if (bounds[s] > bounds[s + 1]) fail();
+      const char* segment = &at<char>(bounds[s], bounds[s + 1] - bounds[s]);
+      arena.addBorrowedBlock(string_view(segment, bounds[s + 1] - bounds[s]),
+                             owner);
+    }
+    if (entry.encoding == dictionaryEncoding) {
+      // the dictionary is small so its values are checked and copied
+      const StrRef* refs = &at<StrRef>(entry.refsOffset, entry.refsCount);
+      col.dictionary = make_shared<Dictionary>();
+      for (size_t i = 0; i < entry.refsCount; i++) {
+        if (refs[i].block >= entry.segmentCount ||
+            uint64_t(refs[i].offset) + refs[i].length >
+                bounds[refs[i].block + 1] - bounds[refs[i].block]) {
+          fail();
+        }
+        // the values of a dictionary are distinct, so they get their codes
+        // back in order
+        if (col.dictionary->encode(arena.view(refs[i])) != i) fail();
+      }
+      // while the codes are borrowed
+      const uint32_t* codes = &at<uint32_t>(entry.valuesOffset, rowCount);
+      col.encoded = true;
+      col.codes.appendBorrowed(span<const uint32_t>(codes, rowCount), owner);
+    } else {
+      // the locations and the bytes of the strings are both borrowed
+      const StrRef* refs = &at<StrRef>(entry.valuesOffset, rowCount);
+      col.arena.swap(arena);
+      col.rows.appendBorrowed(span<const StrRef>(refs, rowCount), owner);
+    }
+  }
+};
+
+void Table::to_snapshot(const string& path) {
+  // the writer reads the storage of the columns directly
+  Snapshot::write(*this, path);
+}
+
+void Table::from_snapshot(const string& path) {
+  // the reader points the columns at the mapped file
+  Snapshot::read(*this, path);
+}
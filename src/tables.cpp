@@ -1,17 +1,29 @@
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
 #include <strfmt/strfmt.hpp>  // library of simple generic functions Mustafa and Azi wrote to be used in the main program. Source code found at libs/strfmt
 #include <utility>
 #include <variant>
 
+#include "parallel.hpp"
 #include "tabluzzy.hpp"
+#include "writer.hpp"
 
 using namespace std;
 
 #include <terminalcancer/terminalcancer.hpp>  // library of simple terminal helper functions to be used in program written by Mustafa
 
 // constructor for an empty table
-Table::Table(){};
+Table::Table() {
+  columns = 0;
+  rows = 0;
+};
 
 // overloaded constructor and set the dimensions of the table
 Table::Table(size_t col, size_t row) {
@@ -22,9 +34,9 @@ Table::Table(size_t col, size_t row) {
 // destructor class for table
 Table::~Table(){};
 
-string Table::getValueAt(string header, size_t rowNo) {
-  // gets the column by column header
-  Column col = getColumnByHeader(header);
+string Table::getValueAt(const string& header, size_t rowNo) {
+  // gets a reference to the column by column header
+  Column& col = getColumnByHeader(header);
   // column gets the value at row number in the column
   return col[rowNo];
 };
@@ -36,11 +48,69 @@ void Table::addColumn(string header, ValueType dttype) {
   int newIndex = data.size();
   // we set the column to that index
   newCol.setIndex(newIndex);
+  // the column tells the table when its header is set
+  newCol.headerGeneration = headerCounter.count;
   // and we add the new column to the list of columns
   data.push_back(newCol);
+  // the index keeps the first column with a header if headers repeat
+  headerIndex.emplace(header, newIndex);
+  headers.push_back(header);
+  // the number of columns follows the list of columns
+  columns = data.size();
+};
+
+void Table::rebuildHeaderIndex() {
+  // we start from an empty index
+  headerIndex.clear();
+  headers.clear();
+  // and map every header to the first column that has it, pointing the
+  // columns copied from another table at the counter of this one
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i].headerGeneration = headerCounter.count;
+    headerIndex.emplace(data[i].getHeader(), i);
+    headers.push_back(data[i].getHeader());
+  }
+  // the index is now up to date with every header set so far
+  indexedGeneration = headerCounter.count->load(memory_order_relaxed);
+};
+
+bool Table::isHeaderIndexCurrent() const {
+  // the columns of a copy still count on the table they were copied from
+  // until the index is rebuilt, and a header may have been set since
+  if (data.empty()) return true;
+  return data[0].headerGeneration == headerCounter.count &&
+         indexedGeneration == headerCounter.count->load(memory_order_relaxed);
+};
+
+void Table::refreshHeaderIndex() {
+  // if a header was set on a column since the index was built, we rebuild
+  if (!isHeaderIndexCurrent()) rebuildHeaderIndex();
+};
+
+int Table::findColumnIndex(const string& header) const {
+  // an index that is out of date is not rebuilt, the headers are scanned
+  if (!isHeaderIndexCurrent()) {
+    for (size_t x = 0; x < data.size(); x++) {
+      if (data[x].getHeader() == header) return x;
+    }
+    return -1;
+  }
+  auto found = headerIndex.find(header);
+  return (found == headerIndex.end()) ? -1 : found->second;
+};
+
+int Table::findColumnIndex(const string& header) {
+  // we make sure the index knows about renamed columns
+  refreshHeaderIndex();
+  // we look the header up in the index
+  auto found = headerIndex.find(header);
+  // and return -1 if there is no column with that header
+  return (found == headerIndex.end()) ? -1 : found->second;
 };
 
 void Table::deleteRow(size_t rowIndex) {
+  // the index is a position, so pending deletions are applied first
+  compact();
   // for every column in columns
   for (size_t i = 0; i < columns; i++) {
     // we get a reference to the column
@@ -52,40 +122,115 @@ void Table::deleteRow(size_t rowIndex) {
   rows--;
 };
 
+size_t Table::deleteRows(span<const size_t> rowIndexes) {
+  // we visit the rows to delete in order, each of them once
+  vector<size_t> targets(rowIndexes.begin(), rowIndexes.end());
+  sort(targets.begin(), targets.end());
+  targets.erase(unique(targets.begin(), targets.end()), targets.end());
+
+  size_t marked = 0;
+  if (deletedCount == 0) {
+    // nothing is pending so the indexes are the positions in the columns
+    deleted.assign(rows, false);
+    for (size_t row : targets) {
+      if (row >= rows) break;
+      deleted[row] = true;
+      marked++;
+    }
+  } else {
+    // otherwise the indexes count only the rows that are left, so we walk
+    // the flags once to find their positions
+    size_t live = 0, t = 0;
+    for (size_t row = 0; row < rows && t < targets.size(); row++) {
+      if (deleted[row]) continue;
+      if (live == targets[t]) {
+        deleted[row] = true;
+        marked++;
+        t++;
+      }
+      live++;
+    }
+  }
+  deletedCount += marked;
+  // the flags are dropped if none of the indexes was in range
+  if (deletedCount == 0) deleted.clear();
+  return marked;
+};
+
+size_t Table::deleteRowsWhere(const function<bool(size_t)>& predicate) {
+  // the predicate may read the table, so it only ever sees compacted rows
+  compact();
+  // we collect the flags on the side and install them once every row was
+  // tested
+  vector<bool> mask(rows, false);
+  size_t marked = 0;
+  for (size_t row = 0; row < rows; row++) {
+    if (predicate(row)) {
+      mask[row] = true;
+      marked++;
+    }
+  }
+  if (marked != 0) {
+    deleted = move(mask);
+    deletedCount = marked;
+  }
+  return marked;
+};
+
+void Table::compact() {
+  // if no rows are pending deletion there is nothing to do
+  if (deletedCount == 0) return;
+  // we collect the rows that are kept, in order
+  vector<size_t> kept;
+  kept.reserve(rows - deletedCount);
+  for (size_t row = 0; row < rows; row++) {
+    if (!deleted[row]) kept.push_back(row);
+  }
+  // and gather every column into them in a single pass, the columns in
+  // parallel
+  getThreadPool().parallelFor(data.size(), [this, &kept](size_t x) {
+    data[x].applyPermutation(kept);
+  });
+  rows = kept.size();
+  deleted.clear();
+  deletedCount = 0;
+};
+
+size_t Table::getNumberOfDeletedRows() const {
+  // returns the number of rows pending deletion
+  return deletedCount;
+};
+
+const ParseReport& Table::getParseReport() const {
+  // returns the counts of the last csv load
+  return parseReport;
+};
+
 Column& Table::operator[](size_t i) {
+  // the column may be changed by position, so pending deletions are applied
+  compact();
   // we return the column at index i
   return data[i];
 };
 
-Column Table::operator[](size_t i) const {
-  // we get the column at index i
-  const Column col = data[i];
-  // we return the column
-  return col;
+const Column& Table::operator[](size_t i) const {
+  // we return a read only reference to the column at index i
+  return data[i];
 };
 
-bool Table::columnExists(string header) {
-  // for every column in columns
-  for (int i = 0; i <= columns; i++) {
-    // if the header is the same as the header
-    if (cmpstr(operator[](i).getHeader(), header)) {
-      // we return true and exit the function
-      return true;
-    };
-  };
-  // otherwise if none of them matched we return false
-  return false;
+bool Table::columnExists(const string& header) {
+  // the column exists if the header index knows it
+  return findColumnIndex(header) != -1;
 }
 
-Column& Table::getColumnByHeader(string header) {
-  // for every column in columns
-  for (int i = 0; i <= data.size(); i++) {
-    // if the column header matches the column header passed into the function
-    if (cmpstr(operator[](i).getHeader(), header)) {
-      // we return a reference to that column header
-      return operator[](i);
-    };
-  };
+Column& Table::getColumnByHeader(const string& header) {
+  // the column may be read or changed by position, so pending deletions are
+  // applied
+  compact();
+  // we look the column up in the header index
+  int index = findColumnIndex(header);
+  // if the column exists we return a reference to it
+  if (index != -1) return operator[](index);
   // otherwise we return the first column (optimally youd check for the
   // existence of the queried column using columnExists(), so youll never reach
   // this case )
@@ -93,71 +238,31 @@ Column& Table::getColumnByHeader(string header) {
 };
 
 void Table::displayTable() const {
-  if (columns == 0) {
-    cout << "Table is empty" << endl;
-  } else if (columns == 1) {
+  if (columns == 1 && deletedCount == 0) {
+    TABLUZZY_TIME(displayTimer);
     operator[](0).displayColumn();
   } else {
-    // gets the terminal dimension
-    auto [w, h] = getTerminalDimensions();
-
-    cout << endl;
-    // draws a line
-    cout << "+" << setfill('=') << setw(16 * columns - 1) << "" << setw(1)
-         << setfill(' ') << "+" << endl;
-
-    cout << "|";
-
-    // for every column in the table
-    for (int x = 0; x < columns; x++) {
-      // we get the column
-      Column col = operator[](x);
-      // we output the header
-      cout << bold << colorfmt(fg::green) << col.getHeader() << left << setw(8)
-           << "\t"
-           << "\t" << clearfmt;
-    };
-    cout << "|" << endl;
-    // for every row in rows
-    for (int y = 0; y < rows; y++) {
-      cout << "|";
-      // for every column in column
-      for (int x = 0; x < columns; x++) {
-        // we get column at index x
-        Column col = operator[](x);
-        // if the column is of type float
-        if (col.getValueType() == ValueType::flt) {
-          // we set the precision to 0 and output it
-          cout << setw(8) << setfill(' ') << setprecision(0) << left << fixed
-               << stof(col.getValueAt(y)) << "\t"
-               << "|";
-
-          // however, if the column is of type string
-        } else if (col.getValueType() == ValueType::str) {
-          // we output it
-          cout << setw(8) << setfill(' ') << col.getValueAt(y) << "\t"
-               << "|";
-        }
-      }
-      cout << endl;
-    };
-    // we draw a line
-    cout << "+" << setfill('=') << setw(16 * columns - 1) << "" << setw(1)
-         << setfill(' ') << "+" << endl;
+    // the view of the table skips the rows pending deletion
+    TableView(*this).displayTable();
   }
 };
 
 void Table::from_csv(vector<vector<string>>& csv) {
+  TABLUZZY_TIME(csvLoadTimer);
   // gets the number of columns and number of rows from the first two lines in
   // the csv file and convert them to integer
-  int colNo = stoi(csv[0][0]), rowNo = stoi(csv[1][0]);
+  size_t colNo, rowNo;
+  if (!parseCount(csv[0][0], colNo) || !parseCount(csv[1][0], rowNo)) {
+    throw runtime_error("csv does not start with its dimensions");
+  }
+  parseReport = ParseReport();
 
-  // we set the columns and rows of this table object to colNo and rowNo
-  columns = colNo;
+  // we set the rows of this table object to rowNo, the columns are counted
+  // as they are added
   rows = rowNo;
 
   // for every column in columns
-  for (int x = 0; x < columns; x++) {
+  for (size_t x = 0; x < colNo; x++) {
     // we get the header
     string header = csv[2][x];
     // we declare a variable to hold the datatype of the current column
@@ -173,6 +278,10 @@ void Table::from_csv(vector<vector<string>>& csv) {
     }
     // we add this new column
     addColumn(header, dttype);
+    // string columns are dictionary encoded while they repeat their values
+    data.back().setStringEncoding(automaticEncoding);
+    // and we reserve its storage up front since we know the number of rows
+    data.back().reserve(rows);
   };
 
   // here we populate the columns in the table
@@ -181,298 +290,203 @@ void Table::from_csv(vector<vector<string>>& csv) {
     // for every column in columns
     for (int col = 0; col < columns; col++) {
       // we get the value from the 2D vector representing the strings
-      string value = csv[row][col];
-
-      // and we populate the columns with it
-      operator[](col).pushValue(value);
+      string& value = csv[row][col];
+
+      // and we populate the columns with it, counting the cells that are not
+      // numbers
+      if (data[col].getValueType() == ValueType::flt) {
+        double number;
+        parseReport.add(parseNumber(value, number), row - 4, col);
+        data[col].pushNumber(number);
+      } else {
+        data[col].pushValue(move(value));
+      }
     }
   }
+
+  // now that every value was seen we settle the encoding of the string
+  // columns
+  for (int col = 0; col < columns; col++) {
+    data[col].setStringEncoding(automaticEncoding);
+  }
 };
 
 vector<string> Table::to_csv() {
-  // declare a variable that holds the lines of csv to be outputted
-  vector<string> csv;
-
-  // we convert the number of columns to strings
-  string c = to_string(columns);
-  // we convert the number of rows to strings
-  string r = to_string(rows);
-
-  // we add a line for the number of columns and a line for the number of rows
-  csv.push_back(c);
-  csv.push_back(r);
-
-  // we get all the column headers from the table
-  vector<string> headers = getAllColumnHeaders();
-  // we join them using ',' as a delimtered
-  string entry = join(headers, ",");
-  // we add that line to the list of csv liens
-  csv.push_back(entry);
-
-  // we reset the entry variable
-  entry = "";
-
-  // we create a vector to store the string representation of the data types of
-  // each column
-  vector<string> datatypes;
-
-  // for every column in columns
-  for (int x = 0; x < columns; x++) {
-    // we get the string representation of the data type of the column
-    // using a ternary operator for brevity
-    string dttype =
-        (data[x].getValueType() == ValueType::flt) ? "number" : "string";
-    // we add the representation to datatypes
-    datatypes.push_back(dttype);
-  }
-  // we join the datatype representations using ',' as a delimiter
-  entry = join(datatypes, ",");
+  // the view of the table skips the rows pending deletion
+  return TableView(*this).to_csv();
+}
 
-  // we add that line to csv
-  csv.push_back(entry);
+void Table::to_csv(ostream& out) { TableView(*this).to_csv(out); }
 
-  // then declare a vector for values
-  vector<string> values;
-  // for every row in rows
-  for (int y = 0; y < rows; y++) {
-    // for every column in columns
-    for (int x = 0; x < columns; x++) {
-      // we add the value at row y at column x
-      values.push_back(data[x][y]);
-    }
-    // we join the values using ','
-    entry = join(values, ",");
-    // we add that line to entries
-    csv.push_back(entry);
-  };
-  return csv;
-}
+void Table::to_csv(int fd) { TableView(*this).to_csv(fd); }
 
 vector<string> Table::to_html() {
-  // declare a variable to store the html tags
-  vector<string> tags;
-
-  // we generate the first static part of the html
-  tags.push_back(R"(
-  <!DOCTYPE html>
-    <html>
-    <head>
-      <meta charset="UTF-8">
-      <title>Table</title>
-      <link rel="stylesheet" href="https://cdnjs.cloudflare.com/ajax/libs/meyer-reset/2.0/reset.min.css">
-      <link rel="stylesheet" href="css/style.css">
-    </head>
-    <body>
-      <section>
-        <h1>Table</h1>
-        <div class="tbl-header">
-        <table cellpadding="0" cellspacing="0" border="0">
-          <thead>
-            <tr>)");
-
-  // declare a variable that holds the tag
-  string tag;
-
-  // for every column in columns
-  for (int x = 0; x < columns; x++) {
-    // we get the header of that column
-    string header = operator[](x).getHeader();
-    // we enclose it in table header tags
-    tag = "<th>" + header + "</th>";
-    // we add it to tags
-    tags.push_back(tag);
-  };
+  // the view of the table skips the rows pending deletion
+  return TableView(*this).to_html();
+};
 
-  tags.push_back(R"(
-          </tr>
-        </thead>
-      </table>
-      </div>
-      <div class="tbl-content">
-      <table cellpadding="0" cellspacing="0" border="0">
-    <tbody>)");
-
-  // for every row in rows
-  for (int y = 0; y < rows; y++) {
-    // create a table row in the output html
-    tags.push_back(R"(<tr>)");
-    // for every column in columns
-    for (int x = 0; x < columns; x++) {
-      // gets the value from the table at column x and row y
-      string value = operator[](x).getValueAt(y);
-      // we enclose the value in html tags
-      tag = "<td>" + value + "</td>";
-      // we add that tag to the list of tags
-      tags.push_back(tag);
-    }
-    // ending the table row
-    tags.push_back(R"(</tr>)");
-  };
+void Table::to_html(ostream& out) { TableView(*this).to_html(out); }
 
-  tags.push_back(R"(</tbody>)
-   </table>)");
-  tags.push_back(R"(
-    </div>
-    </section>
-   <script src="js/index.js"></script>
-   </body>
-   </html>)");
-  // return the list of tags to be outputted to a file
-  return tags;
-};
-
-vector<string> Table::getAllColumnHeaders() {
-  // declares a vector of strings to store the headers
-  vector<string> headers;
-  // for every column in columns
-  for (int x = 0; x <= columns; x++) {
-    // get the header of the colummn
-    string header = operator[](x).getHeader();
-    // add it to the list of headers
-    headers.push_back(header);
-  }
+void Table::to_html(int fd) { TableView(*this).to_html(fd); }
 
+const vector<string>& Table::getAllColumnHeaders() {
+  // the headers are kept next to the header index, so we only make sure it
+  // is up to date
+  refreshHeaderIndex();
   // return the list of headers
   return headers;
 };
 
-float Table::getMinimumValue() {
-  // declare a list of float values
-  vector<float> values;
-
-  // for every column in columns
-  for (int x = 0; x < columns; x++) {
-    // get the column
-    Column col = operator[](x);
-    // if the column is of type string then skip that column
-    if (col.getValueType() == ValueType::str) continue;
-    // however if it is of type integer then get the minimum value
-    values.push_back(col.getMinimumValue());
-  }
+Moments Table::getTableMoments() {
+  // the columns reduce their moments in parallel, each of them splitting its
+  // rows into chunks on the same pool
+  vector<const Column*> numerical = getNumericalColumns();
+  vector<Moments> partials(numerical.size());
+  getThreadPool().parallelFor(numerical.size(), [&](size_t i) {
+    // rows pending deletion are left out, bypassing the cache of the column
+    partials[i] = (deletedCount == 0) ? numerical[i]->getMoments()
+                                      : numerical[i]->getMoments(deleted);
+  });
+  // the moments of every float column merge into the moments of the table
+  Moments total;
+  for (const Moments& partial : partials) total.merge(partial);
+  return total;
+};
 
-  // get the minumum of the values and return it
-  return getMin(values);
+float Table::getMinimumValue() {
+  // get the moments of all the numbers in the table
+  Moments moments = getTableMoments();
+  // an empty table has no minimum
+  if (moments.count == 0) return numeric_limits<float>::quiet_NaN();
+  // return the minimum value
+  return moments.min;
 };
 
 float Table::getMaxiumValue() {
-  // declare a list of float values
-  vector<float> values;
-  // for every column in columnss
-  for (int x = 0; x < columns; x++) {
-    // get the column
-    Column col = operator[](x);
-    // if the column is of type string then skip that column
-    if (col.getValueType() == ValueType::str) continue;
-    // however if it is of type integer then get the minimum value
-    values.push_back(col.getMaximumValue());
-  }
-
-  // get the minumum of the values and return it
-  return getMax(values);
+  // get the moments of all the numbers in the table
+  Moments moments = getTableMoments();
+  // an empty table has no maximum
+  if (moments.count == 0) return numeric_limits<float>::quiet_NaN();
+  // return the maximum value
+  return moments.max;
 };
 
 vector<string> Table::getAllValues() {
   // delare a list of strings
   vector<string> rawValues;
+  // we reserve room for every number up front
+  size_t count = 0;
+  for (int x = 0; x < columns; x++) {
+    if (data[x].getValueType() == ValueType::flt) {
+      count += data[x].getNumberOfRows() - deletedCount;
+    }
+  }
+  rawValues.reserve(count);
   // for every column in columns
   for (int x = 0; x < columns; x++) {
-    // get the column
-    Column col = operator[](x);
+    // get a reference to the column
+    const Column& col = data[x];
     // if the column is of type string then skip that column
     if (col.getValueType() == ValueType::str) continue;
-    // if the column is of type float get the values in the column
-    vector<string> rawColValues = col.getAllValues();
-    // for every value in rawValues
-    for (string rawValue : rawColValues) {
-      // add it to the list of values
-      rawValues.push_back(rawValue);
+    // format every value of the column straight into the list of values
+    for (size_t y = 0; y < col.getNumberOfRows(); y++) {
+      if (isDeleted(y)) continue;
+      rawValues.push_back(col.getValueAt(y));
     }
   };
   return rawValues;
 }
 
+vector<const Column*> Table::getNumericalColumns() const {
+  // declare a list of the float columns
+  vector<const Column*> numerical;
+  // for every column in columns
+  for (int x = 0; x < columns; x++) {
+    // if the column is of type float we add it
+    if (data[x].getValueType() == ValueType::flt) numerical.push_back(&data[x]);
+  }
+  return numerical;
+}
+
+vector<double> Table::getAllNumbers() {
+  // every column gets its own range of the list
+  vector<const Column*> numerical = getNumericalColumns();
+  vector<size_t> offsets = {0};
+  for (const Column* col : numerical) {
+    // rows pending deletion are left out
+    size_t count = col->getNumberOfRows() - deletedCount;
+    offsets.push_back(offsets.back() + count);
+  }
+  vector<double> values(offsets.back());
+  // so the columns can be copied over in parallel
+  getThreadPool().parallelFor(numerical.size(), [&](size_t i) {
+    double* out = values.data() + offsets[i];
+    size_t row = 0;
+    numerical[i]->forEachNumberBlock([&](span<const double> block) {
+      if (deletedCount == 0) {
+        out = copy(block.begin(), block.end(), out);
+      } else {
+        // rows pending deletion are left out
+        for (size_t y = 0; y < block.size(); y++) {
+          if (!deleted[row + y]) *out++ = block[y];
+        }
+      }
+      row += block.size();
+    });
+  });
+  return values;
+}
+
 float Table::getMedian() {
-  // get all the values in the table
-  vector<string> rawValues = getAllValues();
-  // convert every value to float
-  vector<float> values = convertToFloats(rawValues);
-  // calculate the median and return it
-  return calculateMedian(values);
+  TABLUZZY_TIME(statisticsTimer);
+  // get all the numbers in the table
+  vector<double> values = getAllNumbers();
+  // select the median and return it
+  return selectMedian(values);
 };
 float Table::getMean() {
-  // get all the values in the table
-  vector<string> rawValues = getAllValues();
-  // convert every value to float
-  vector<float> values = convertToFloats(rawValues);
-  // calculate the mean and return it
-  return calculateMean(values);
+  // get the moments of all the numbers in the table
+  Moments moments = getTableMoments();
+  // an empty table has no mean
+  if (moments.count == 0) return numeric_limits<float>::quiet_NaN();
+  // return the mean
+  return moments.mean;
 };
 float Table::getVariance() {
-  // get all the values if the table
-  vector<string> rawValues = getAllValues();
-  // convert the values to floats
-  vector<float> values = convertToFloats(rawValues);
-  // calculate the variance and return it
-  return calculateVariance(values);
+  // get the moments of all the numbers in the table
+  Moments moments = getTableMoments();
+  // an empty table has no variance
+  if (moments.count == 0) return numeric_limits<float>::quiet_NaN();
+  // return the population variance
+  return moments.m2 / moments.count;
 };
 float Table::getStdDeviation() {
-  // get all the values in the table
-  vector<string> rawValues = getAllValues();
-  // convert the values to floats
-  vector<float> values = convertToFloats(rawValues);
-  // calculate the standard deviation and return it
-  return calculateStandardDeviation(values);
+  // the standard deviation is the square root of the variance
+  return sqrt(getVariance());
 };
 
 void Table::displayReport() {
-  // for every column in columns
-  for (int x = 0; x < columns; x++) {
-    // get the column
-    Column col = operator[](x);
-    // if the column is of type string then skip that column
-    if (col.getValueType() == ValueType::str) continue;
-    // if it contains numerical values then calculate all the statistics of the
-    // table
-    float min = col.getMinimumValue();
-    float max = col.getMaximumValue();
-    float median = col.getMedian();
-    float mean = col.getMean();
-    float variance = col.getVariance();
-    float stdv = col.getStdDeviation();
-    auto [a, b] = col.getRegression();
-
-    // and output them
-    cout << "Column " << colorfmt(fg::cyan) << col.getHeader() << clearfmt
-         << ":" << endl
-         << setw(15) << setfill('-') << "" << endl
-         << bold << "min" << clearfmt << " = " << min << endl
-         << bold << "max" << clearfmt << " = " << max << endl
-         << bold << "med" << clearfmt << " = " << median << endl
-         << bold << "μ" << clearfmt << " = " << mean << endl
-         << bold << "σ²" << clearfmt << " = " << variance << endl
-         << bold << "σ" << clearfmt << " = " << stdv << endl
-         << bold << "regr(x,y)" << clearfmt << " : " << bold << "Y" << clearfmt
-         << " = " << colorfmt(fg::yellow) << a << clearfmt << " + "
-         << colorfmt(fg::yellow) << b << clearfmt << "x" << endl
-         << endl;
-  };
-  cout << endl;
+  // the statistics of every float column are computed in parallel, in a
+  // single pass over every column, or none if it did not change since the
+  // last report, rows pending deletion are left out
+  TableView(*this).displayReport();
 };
 
-int Table::getNumberOfRows() {
-  // returns the number of rows in the table
-  return rows;
+int Table::getNumberOfRows() const {
+  // returns the number of rows in the table, without the rows pending
+  // deletion
+  return rows - deletedCount;
 };
-int Table::getNumberOfColumns() {
+int Table::getNumberOfColumns() const {
   // returns the number of columns in the table
   return columns;
 };
 
-void Table::deleteColumn(string& colHeader) {
-  // gets the column by its header
-  Column col = getColumnByHeader(colHeader);
-  // gets the index from the column
-  int index = col.getIndex();
+void Table::deleteColumn(const string& colHeader) {
+  // gets the index of the column from the header index
+  int index = findColumnIndex(colHeader);
+  // if there is no such column there is nothing to delete
+  if (index == -1) return;
   // removes the column from the table
   data.erase(data.begin() + index, data.begin() + index + 1);
 
@@ -480,18 +494,20 @@ void Table::deleteColumn(string& colHeader) {
   columns = cols;
 
   for (int x = 0; x < columns; x++) {
-    operator[](x).setIndex(x);
+    data[x].setIndex(x);
   }
-  // decrements columns by 1
+  // the columns after the deleted one moved, so the index is rebuilt
+  rebuildHeaderIndex();
 };
 
 bool Table::canBeInsertedIntoTable(vector<string> values) {
   // for every column in columns
   for (int i = 0; i < columns; i++) {
     // if the column has type float
-    if (operator[](i).getValueType() == ValueType::flt) {
-      // if the value for that column cannot be converted to type float
-      if (!stringIsFloat(values[i])) {
+    if (data[i].getValueType() == ValueType::flt) {
+      // if the value for that column is neither a number nor missing
+      double number;
+      if (parseNumber(values[i], number) == invalidNumber) {
         // then return false
         return false;
       }
@@ -501,7 +517,10 @@ bool Table::canBeInsertedIntoTable(vector<string> values) {
   return true;
 };
 
-void Table::insertRowAtIndex(vector<string>& rawValues, size_t rowIndex) {
+void Table::insertRowAtIndex(const vector<string>& rawValues,
+                             size_t rowIndex) {
+  // the index is a position, so pending deletions are applied first
+  compact();
   // for every column in columns
   for (size_t i = 0; i < columns; i++) {
     // get the reference to the column
@@ -513,53 +532,114 @@ void Table::insertRowAtIndex(vector<string>& rawValues, size_t rowIndex) {
   rows += 1;
 };
 
-void Table::sortTableByColumn(string& colHeader) {
-  // get the column by its header
-  Column col = getColumnByHeader(colHeader);
-  // get all the values in that column
-  vector<string> rawValues = col.getAllValues();
-  // convert all those values to floats
-  vector<float> values = convertToFloats(rawValues);
-
-  // using bubble sort, sort the table
-  // variable to check if a swap was made in the last pass
-  bool swapped;
-  // getting the number of values
-  int n = values.size();
-  // for every element in the list
-  for (int i = 0; i < n - 1; i++) {
-    // for every element that not peen pushed to the end
-    for (int j = 0; j < n - i - 1; j++) {
-      // if the first element is bigger than the second element
-      if (values[j] > values[j + 1]) {
-        // swap the values using std::swap
-        swap(values[j], values[j + 1]);
-        // swapTableRows() to apply that swap to every row in the table
-        swapTablRows(j, j + 1);
-        // setting swapped to true
-        swapped = true;
-      }
+void Table::insertRowAtIndex(vector<string>&& rawValues, size_t rowIndex) {
+  // the index is a position, so pending deletions are applied first
+  compact();
+  // for every column in columns
+  for (size_t i = 0; i < columns; i++) {
+    // insert the value into column at index rowIndex
+    operator[](i).insertAtRowIndex(rowIndex, move(rawValues[i]));
+  };
+  // increment the number of rows by 1
+  rows += 1;
+};
+
+// tables with fewer rows than this are always sorted on a single thread
+static const size_t PARALLEL_SORT_THRESHOLD = 1 << 16;
+
+void Table::sortTableByColumn(const string& colHeader, SortOrder order,
+                              bool parallel) {
+  // sorting by a single column is a sort with a single key
+  sortTableByColumns({{colHeader, order}}, parallel);
+};
+
+void Table::sortTableByColumns(const vector<SortKey>& keys, bool parallel) {
+  TABLUZZY_TIME(sortTimer);
+  // we compute the sorted order once and move every column into it
+  applyRowPermutation(getSortPermutation(keys, parallel));
+};
+
+vector<size_t> Table::getSortPermutation(const vector<SortKey>& keys,
+                                         bool parallel) {
+  // the permutation holds positions, so pending deletions are applied first
+  compact();
+  TABLUZZY_COUNT(rowsScanned, rows);
+  // we resolve the columns of the keys once instead of on every comparison
+  vector<pair<const Column*, SortOrder>> sortColumns;
+  for (const SortKey& key : keys) {
+    sortColumns.push_back({&getColumnByHeader(key.header), key.order});
+    // encoded columns rank their dictionary so their rows compare as integers
+    sortColumns.back().first->prepareCompare();
+  }
+
+  // a row is smaller if the first key that differs orders it first
+  auto before = [&sortColumns](size_t a, size_t b) {
+    for (auto& [col, order] : sortColumns) {
+      int cmp = col->compareRows(a, b);
+      if (cmp != 0) return (order == ascending) ? cmp < 0 : cmp > 0;
     }
-    // the there was no swap in the last pass then break the loop prematurely
-    // for the list is sorted
-    if (!swapped) break;
+    return false;
   };
+
+  // we start from the identity permutation
+  vector<size_t> permutation(rows);
+  iota(permutation.begin(), permutation.end(), 0);
+
+  ThreadPool& pool = getThreadPool();
+  size_t threadCount = pool.getThreadCount();
+  if (!parallel || rows < PARALLEL_SORT_THRESHOLD || threadCount < 2) {
+    stable_sort(permutation.begin(), permutation.end(), before);
+    return permutation;
+  }
+
+  // we stable sort one run per thread
+  vector<size_t> bounds;
+  for (size_t t = 0; t <= threadCount; t++) {
+    bounds.push_back(rows * t / threadCount);
+  }
+  pool.parallelFor(threadCount, [&](size_t t) {
+    stable_sort(permutation.begin() + bounds[t],
+                permutation.begin() + bounds[t + 1], before);
+  });
+
+  // and merge neighbouring runs until one is left, merging keeps the sort
+  // stable because the left run always comes first
+  for (size_t width = 1; width < threadCount; width *= 2) {
+    size_t merges = (threadCount - width + 2 * width - 1) / (2 * width);
+    pool.parallelFor(merges, [&, width](size_t m) {
+      size_t t = m * 2 * width;
+      size_t first = bounds[t], middle = bounds[t + width];
+      size_t last = bounds[min(t + 2 * width, threadCount)];
+      inplace_merge(permutation.begin() + first, permutation.begin() + middle,
+                    permutation.begin() + last, before);
+    });
+  }
+  return permutation;
+};
+
+void Table::applyRowPermutation(const vector<size_t>& permutation) {
+  // the permutation holds positions, so pending deletions are applied first
+  compact();
+  // for every column in columns
+  for (int x = 0; x < columns; x++) {
+    // we gather the values of the column in the new order
+    operator[](x).applyPermutation(permutation);
+  }
 };
 
 void Table::swapTablRows(size_t rowIndex1, size_t rowIndex2) {
+  // the indexes are positions, so pending deletions are applied first
+  compact();
   // for every element in columns
   for (int x = 0; x < columns; x++) {
-    // we get the reference to the column
-    Column& col = operator[](x);
-    // we swap the values at rowIndex1 and rowIndex2
-    string tmp1 = col.getValueAt(rowIndex1);
-    string tmp2 = col.getValueAt(rowIndex2);
-    col.setValueAt(rowIndex1, tmp2);
-    col.setValueAt(rowIndex2, tmp1);
+    // we swap the values at rowIndex1 and rowIndex2 in place
+    operator[](x).swapRows(rowIndex1, rowIndex2);
   }
 };
 
 vector<string> Table::getAllValuesInRow(size_t rowNo) {
+  // the index is a position, so pending deletions are applied first
+  compact();
   vector<string> rawValues;
   // for every column in columns
   for (int x = 0; x < columns; x++) {
@@ -570,46 +650,97 @@ vector<string> Table::getAllValuesInRow(size_t rowNo) {
   };
   return rawValues;
 };
-int Table::getRowIndexOfFirstOccurrence(string& colHeader, string value) {
-  // we get the column by its header
-  Column col = getColumnByHeader(colHeader);
-  // we get all the values in that column
-  vector<string> rawValues = col.getAllValues();
-  // for every value in rawValues
-  for (int i = 0; i < rawValues.size(); i++) {
-    // we compare the string to the string value
-    if (cmpstr(rawValues[i], value)) {
-      // if they are the same we return the index
-      return i;
-    }
+int Table::getRowIndexOfFirstOccurrence(const string& colHeader,
+                                        string value) {
+  // we get a reference to the column by its header
+  Column& col = getColumnByHeader(colHeader);
+  // numbers are compared by value so that "3.50" still finds 3.5
+  if (col.getValueType() == ValueType::flt) {
+    // a value that is not a number can never match
+    double number;
+    if (parseNumber(value, number) != parsedNumber) return -1;
+    return col.findFirstRow(number);
   }
-  // else we return -1, signifying there are no matches
-  return -1;
+  // strings are looked up in the index of the column, or scanned for
+  return col.findFirstRow(string_view(value));
 };
 
-int Table::getRowIndexOfFirstOccurrence(string& colHeader, size_t value) {
-  // we get the column by its header
-  Column col = getColumnByHeader(colHeader);
-  // we get all the values in that column
-  vector<string> rawValues = col.getAllValues();
-  // for every value in rawValues
-  for (int i = 0; i < rawValues.size(); i++) {
-    // we check if the value at that row index is the same as the value passed
-    // in
-    float colVal = stoi(rawValues[i]);
-    // if they are the same
-    if (colVal == value) {
-      // we return the index of that element
-      return i;
+// reads the integer a text starts with the way stoi does, skipping leading
+// whitespace and dropping everything after the digits
+static bool parseLeadingInteger(string_view text, long long& integer) {
+  size_t start = 0;
+  while (start < text.size() && isspace((unsigned char)text[start])) start++;
+  // from_chars takes a minus sign but not a plus sign
+  if (start + 1 < text.size() && text[start] == '+' &&
+      text[start + 1] != '-') {
+    start++;
+  }
+  const char* last = text.data() + text.size();
+  return from_chars(text.data() + start, last, integer).ec == errc();
+}
+
+int Table::getRowIndexOfFirstOccurrence(const string& colHeader,
+                                        size_t value) {
+  // we get a reference to the column by its header
+  Column& col = getColumnByHeader(colHeader);
+  // a value matches the numbers that truncate to it, so 3 finds 3.7, which
+  // is a range query on an indexed float column
+  if (col.getValueType() == ValueType::flt) {
+    double low = value, high = nextafter(low + 1, low);
+    // numbers between -1 and 0 truncate to 0 too
+    if (value == 0) low = nextafter(-1.0, 0.0);
+    vector<size_t> found = col.findRowsInRange(low, high);
+    return found.empty() ? -1 : found.front();
+  }
+  // string columns match by the integer their text starts with, text that
+  // does not start with an integer never matches
+  long long integer;
+  for (size_t y = 0; y < col.getNumberOfRows(); y++) {
+    if (parseLeadingInteger(col.getStringAt(y), integer) && integer >= 0 &&
+        size_t(integer) == value) {
+      TABLUZZY_COUNT(rowsScanned, y + 1);
+      return y;
     }
   }
-  // else we return -1 to signify no matches were found
+  TABLUZZY_COUNT(rowsScanned, col.getNumberOfRows());
   return -1;
 };
 
+vector<size_t> Table::getRowIndexesOfAllOccurrences(const string& colHeader,
+                                                    const string& value) {
+  // we get a reference to the column by its header
+  Column& col = getColumnByHeader(colHeader);
+  // numbers are compared by value, like for the first occurrence
+  if (col.getValueType() == ValueType::flt) {
+    double number;
+    if (parseNumber(value, number) != parsedNumber) return {};
+    return col.findAllRows(number);
+  }
+  return col.findAllRows(string_view(value));
+};
+
+vector<size_t> Table::getRowIndexesInRange(const string& colHeader,
+                                           double low, double high) {
+  // we get a reference to the column by its header and query its range
+  return getColumnByHeader(colHeader).findRowsInRange(low, high);
+};
+
+void Table::createIndex(const string& colHeader) {
+  // the index lives in the column and follows its mutators
+  getColumnByHeader(colHeader).createIndex();
+};
+
+void Table::dropIndex(const string& colHeader) {
+  getColumnByHeader(colHeader).dropIndex();
+};
+
 void Table::flushTable() {
   // used to clear the table from its previos values
   data.clear();
+  headerIndex.clear();
+  headers.clear();
+  deleted.clear();
+  deletedCount = 0;
   // sets the table dimensions to 0
   columns = 0;
   rows = 0;
@@ -0,0 +1,506 @@
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <strfmt/strfmt.hpp>  // library of simple generic functions Mustafa and Azi wrote to be used in the main program. Source code found at libs/strfmt
+
+#include "tabluzzy.hpp"
+#include "view.hpp"
+#include "writer.hpp"
+
+using namespace std;
+
+#include <terminalcancer/terminalcancer.hpp>  // library of simple terminal helper functions to be used in program written by Mustafa
+
+// the number of rows of a view whose numbers are gathered by a single task
+static const size_t VIEW_CHUNK = 1 << 16;
+
+TableView::TableView(const Table& table) : table(&table), count(table.rows) {
+  // every column, in order
+  columnIndexes.resize(table.data.size());
+  for (size_t x = 0; x < columnIndexes.size(); x++) columnIndexes[x] = x;
+  // rows pending deletion are left out
+  if (table.deletedCount != 0) {
+    vector<size_t> kept;
+    kept.reserve(table.rows - table.deletedCount);
+    for (size_t y = 0; y < table.rows; y++) {
+      if (!table.deleted[y]) kept.push_back(y);
+    }
+    count = kept.size();
+    rowIndexes = make_shared<const vector<size_t>>(move(kept));
+  }
+}
+
+const Column& TableView::getColumn(size_t x) const {
+  return table->data[columnIndexes[x]];
+}
+
+string TableView::getValueAt(const string& header, size_t row) const {
+  int x = findColumn(header);
+  if (x == -1) throw runtime_error("no column with header " + header);
+  return getColumn(x).getValueAt(getRowIndex(row));
+}
+
+int TableView::findColumn(const string& header) const {
+  // the first viewed column with the header
+  for (size_t x = 0; x < columnIndexes.size(); x++) {
+    if (getColumn(x).getHeader() == header) return x;
+  }
+  return -1;
+}
+
+bool TableView::viewsEveryRow() const {
+  return !rowIndexes && first == 0 && count == table->rows;
+}
+
+TableView TableView::withRowIndexes(vector<size_t> indexes) const {
+  TableView view = *this;
+  view.first = 0;
+  view.count = indexes.size();
+  view.rowIndexes = make_shared<const vector<size_t>>(move(indexes));
+  return view;
+}
+
+TableView TableView::select(const vector<string>& headers) const {
+  TableView view = *this;
+  view.columnIndexes.clear();
+  for (const string& header : headers) {
+    int x = findColumn(header);
+    if (x == -1) throw runtime_error("no column with header " + header);
+    view.columnIndexes.push_back(columnIndexes[x]);
+  }
+  return view;
+}
+
+TableView TableView::slice(size_t first, size_t rowCount) const {
+  // the range only moves the bounds, the row indexes are shared
+  TableView view = *this;
+  first = min(first, count);
+  view.first += first;
+  view.count = min(rowCount, count - first);
+  return view;
+}
+
+TableView TableView::withRows(const vector<size_t>& rows) const {
+  vector<size_t> indexes;
+  indexes.reserve(rows.size());
+  for (size_t row : rows) {
+    if (row >= count) throw out_of_range("row out of range of the view");
+    indexes.push_back(getRowIndex(row));
+  }
+  return withRowIndexes(move(indexes));
+}
+
+TableView TableView::where(const Predicate& predicate) const {
+  // the predicate is evaluated on the columns of the whole table, and the
+  // rows of the view that match are kept
+  Selection selection = Predicate::evaluateNode(*predicate.node, *table);
+  vector<size_t> indexes;
+  for (size_t y = 0; y < count; y++) {
+    size_t row = getRowIndex(y);
+    if (selection.test(row)) indexes.push_back(row);
+  }
+  return withRowIndexes(move(indexes));
+}
+
+TableView TableView::sortedBy(const vector<SortKey>& keys) const {
+  TABLUZZY_TIME(sortTimer);
+  // we resolve the columns of the keys once instead of on every comparison
+  vector<pair<const Column*, SortOrder>> sortColumns;
+  for (const SortKey& key : keys) {
+    int index = table->findColumnIndex(key.header);
+    if (index == -1) throw runtime_error("no column with header " + key.header);
+    sortColumns.push_back({&table->data[index], key.order});
+    // encoded columns rank their dictionary so their rows compare as integers
+    sortColumns.back().first->prepareCompare();
+  }
+  // a row is smaller if the first key that differs orders it first
+  auto before = [&sortColumns](size_t a, size_t b) {
+    for (auto& [col, order] : sortColumns) {
+      int cmp = col->compareRows(a, b);
+      if (cmp != 0) return (order == ascending) ? cmp < 0 : cmp > 0;
+    }
+    return false;
+  };
+  vector<size_t> indexes(count);
+  for (size_t y = 0; y < count; y++) indexes[y] = getRowIndex(y);
+  stable_sort(indexes.begin(), indexes.end(), before);
+  return withRowIndexes(move(indexes));
+}
+
+void TableView::displayTable() const {
+  TABLUZZY_TIME(displayTimer);
+  size_t columns = columnIndexes.size();
+  if (columns == 0) {
+    cout << "Table is empty" << endl;
+    return;
+  }
+  cout << endl;
+  // draws a line
+  cout << "+" << setfill('=') << setw(16 * columns - 1) << "" << setw(1)
+       << setfill(' ') << "+" << endl;
+
+  cout << "|";
+
+  // for every column in the view we output the header
+  for (size_t x = 0; x < columns; x++) {
+    cout << bold << colorfmt(fg::green) << getColumn(x).getHeader() << left
+         << setw(8) << "\t"
+         << "\t" << clearfmt;
+  };
+  cout << "|" << endl;
+  // for every row in the view
+  for (size_t y = 0; y < count; y++) {
+    size_t row = getRowIndex(y);
+    cout << "|";
+    // for every column in the view
+    for (size_t x = 0; x < columns; x++) {
+      const Column& col = getColumn(x);
+      // if the column is of type float
+      if (col.getValueType() == ValueType::flt) {
+        // we set the precision to 0 and output it
+        cout << setw(8) << setfill(' ') << setprecision(0) << left << fixed
+             << col.getNumberAt(row) << "\t"
+             << "|";
+
+        // however, if the column is of type string
+      } else if (col.getValueType() == ValueType::str) {
+        // we output it
+        cout << setw(8) << setfill(' ') << col.getStringAt(row) << "\t"
+             << "|";
+      }
+    }
+    cout << endl;
+  };
+  // we draw a line
+  cout << "+" << setfill('=') << setw(16 * columns - 1) << "" << setw(1)
+       << setfill(' ') << "+" << endl;
+}
+
+// appends a csv field, quoting it if it holds a delimiter, a quote or a line
+// break so it reads back as the same text
+static void appendCsvField(string& line, string_view field) {
+  if (field.find_first_of(",\"\r\n") == string_view::npos) {
+    line.append(field);
+    return;
+  }
+  line.push_back('"');
+  for (char c : field) {
+    // quotes are escaped by doubling them
+    if (c == '"') line.push_back('"');
+    line.push_back(c);
+  }
+  line.push_back('"');
+}
+
+// appends text to html, escaping the characters html gives a meaning to
+static void appendHtmlText(string& html, string_view text) {
+  for (char c : text) {
+    switch (c) {
+      case '<':
+        html.append("&lt;");
+        break;
+      case '>':
+        html.append("&gt;");
+        break;
+      case '&':
+        html.append("&amp;");
+        break;
+      default:
+        html.push_back(c);
+    }
+  }
+}
+
+vector<string> TableView::getCsvHeaderLines() const {
+  // declare a variable that holds the header lines
+  vector<string> lines;
+  // a line for the number of columns and a line for the number of rows
+  lines.push_back(to_string(columnIndexes.size()));
+  lines.push_back(to_string(count));
+  // a line with the headers of the columns, and one with their datatypes
+  string headerLine, typeLine;
+  for (size_t x = 0; x < columnIndexes.size(); x++) {
+    if (x > 0) {
+      headerLine.push_back(',');
+      typeLine.push_back(',');
+    }
+    appendCsvField(headerLine, getColumn(x).getHeader());
+    typeLine.append((getColumn(x).getValueType() == ValueType::flt)
+                        ? "number"
+                        : "string");
+  }
+  lines.push_back(headerLine);
+  lines.push_back(typeLine);
+  return lines;
+}
+
+void TableView::appendCsvRow(size_t row, string& line) const {
+  // for every column in the view
+  for (size_t x = 0; x < columnIndexes.size(); x++) {
+    if (x > 0) line.push_back(',');
+    const Column& col = getColumn(x);
+    if (col.getValueType() == ValueType::flt) {
+      // numbers never need quoting, so they are formatted in place
+      col.appendValueAt(row, line);
+    } else {
+      appendCsvField(line, col.getStringAt(row));
+    }
+  }
+}
+
+vector<string> TableView::to_csv() const {
+  TABLUZZY_TIME(csvExportTimer);
+  TABLUZZY_COUNT(rowsScanned, count);
+  // the header block comes first
+  vector<string> csv = getCsvHeaderLines();
+  csv.reserve(csv.size() + count);
+  // then a line for every row
+  for (size_t y = 0; y < count; y++) {
+    string line;
+    appendCsvRow(getRowIndex(y), line);
+    csv.push_back(move(line));
+  }
+  return csv;
+}
+
+void TableView::writeCsv(BufferedWriter& writer) const {
+  TABLUZZY_TIME(csvExportTimer);
+  TABLUZZY_COUNT(rowsScanned, count);
+  // the header block comes first
+  for (const string& line : getCsvHeaderLines()) {
+    writer.write(line);
+    writer.put('\n');
+  }
+  // every row is formatted straight into the buffer of the writer, which
+  // writes a batch of rows out whenever it fills up
+  for (size_t y = 0; y < count; y++) {
+    appendCsvRow(getRowIndex(y), writer.getBuffer());
+    writer.put('\n');
+    writer.endRecord();
+  }
+  writer.flush();
+}
+
+void TableView::to_csv(ostream& out) const {
+  BufferedWriter writer(out);
+  writeCsv(writer);
+}
+
+void TableView::to_csv(int fd) const {
+  BufferedWriter writer(fd);
+  writeCsv(writer);
+}
+
+// the static parts of the html of a table
+static const char* HTML_HEAD = R"(
+  <!DOCTYPE html>
+    <html>
+    <head>
+      <meta charset="UTF-8">
+      <title>Table</title>
+      <link rel="stylesheet" href="https://cdnjs.cloudflare.com/ajax/libs/meyer-reset/2.0/reset.min.css">
+      <link rel="stylesheet" href="css/style.css">
+    </head>
+    <body>
+      <section>
+        <h1>Table</h1>
+        <div class="tbl-header">
+        <table cellpadding="0" cellspacing="0" border="0">
+          <thead>
+            <tr>)";
+static const char* HTML_BODY_START = R"(
+          </tr>
+        </thead>
+      </table>
+      </div>
+      <div class="tbl-content">
+      <table cellpadding="0" cellspacing="0" border="0">
+    <tbody>)";
+static const char* HTML_BODY_END = R"(</tbody>)
+   </table>)";
+static const char* HTML_TAIL = R"(
+    </div>
+    </section>
+   <script src="js/index.js"></script>
+   </body>
+   </html>)";
+
+void TableView::appendHtmlCell(size_t row, size_t x, string& html) const {
+  // we enclose the value in table data tags
+  html.append("<td>");
+  const Column& col = getColumn(x);
+  if (col.getValueType() == ValueType::flt) {
+    col.appendValueAt(row, html);
+  } else {
+    appendHtmlText(html, col.getStringAt(row));
+  }
+  html.append("</td>");
+}
+
+vector<string> TableView::to_html() const {
+  TABLUZZY_TIME(htmlExportTimer);
+  TABLUZZY_COUNT(rowsScanned, count);
+  // declare a variable to store the html tags
+  vector<string> tags;
+
+  // we generate the first static part of the html
+  tags.push_back(HTML_HEAD);
+
+  // for every column we enclose the header in table header tags
+  for (size_t x = 0; x < columnIndexes.size(); x++) {
+    string tag = "<th>";
+    appendHtmlText(tag, getColumn(x).getHeader());
+    tag.append("</th>");
+    tags.push_back(move(tag));
+  };
+
+  tags.push_back(HTML_BODY_START);
+
+  // for every row in the view
+  for (size_t y = 0; y < count; y++) {
+    size_t row = getRowIndex(y);
+    // create a table row in the output html
+    tags.push_back(R"(<tr>)");
+    // with a tag for the value of every column
+    for (size_t x = 0; x < columnIndexes.size(); x++) {
+      string tag;
+      appendHtmlCell(row, x, tag);
+      tags.push_back(move(tag));
+    }
+    // ending the table row
+    tags.push_back(R"(</tr>)");
+  };
+
+  tags.push_back(HTML_BODY_END);
+  tags.push_back(HTML_TAIL);
+  // return the list of tags to be outputted to a file
+  return tags;
+}
+
+void TableView::writeHtml(BufferedWriter& writer) const {
+  TABLUZZY_TIME(htmlExportTimer);
+  TABLUZZY_COUNT(rowsScanned, count);
+  // the same tags as to_html, one per line
+  writer.write(HTML_HEAD);
+  writer.put('\n');
+  for (size_t x = 0; x < columnIndexes.size(); x++) {
+    writer.write("<th>");
+    appendHtmlText(writer.getBuffer(), getColumn(x).getHeader());
+    writer.write("</th>\n");
+  }
+  writer.write(HTML_BODY_START);
+  writer.put('\n');
+  // every row is formatted straight into the buffer of the writer, which
+  // writes a batch of rows out whenever it fills up
+  for (size_t y = 0; y < count; y++) {
+    size_t row = getRowIndex(y);
+    writer.write("<tr>\n");
+    for (size_t x = 0; x < columnIndexes.size(); x++) {
+      appendHtmlCell(row, x, writer.getBuffer());
+      writer.put('\n');
+    }
+    writer.write("</tr>\n");
+    writer.endRecord();
+  }
+  writer.write(HTML_BODY_END);
+  writer.put('\n');
+  writer.write(HTML_TAIL);
+  writer.put('\n');
+  writer.flush();
+}
+
+void TableView::to_html(ostream& out) const {
+  BufferedWriter writer(out);
+  writeHtml(writer);
+}
+
+void TableView::to_html(int fd) const {
+  BufferedWriter writer(fd);
+  writeHtml(writer);
+}
+
+ColumnStats TableView::getStats(const string& header) const {
+  int x = findColumn(header);
+  if (x == -1) throw runtime_error("no column with header " + header);
+  if (getColumn(x).getValueType() != ValueType::flt) {
+    throw runtime_error("column " + header + " does not hold numbers");
+  }
+  return getStats(getColumn(x));
+}
+
+ColumnStats TableView::getStats(const Column& col) const {
+  // a view of the whole column shares the cached statistics of the column
+  if (viewsEveryRow()) return col.getStats();
+
+  TABLUZZY_TIME(statisticsTimer);
+  // otherwise the numbers of the viewed rows are gathered in order, and
+  // reduced, a range of rows per task
+  vector<double> values(count);
+  size_t parts = (count + VIEW_CHUNK - 1) / VIEW_CHUNK;
+  vector<Moments> partials(parts);
+  getThreadPool().parallelFor(parts, [&](size_t p) {
+    size_t start = p * VIEW_CHUNK, end = min(count, start + VIEW_CHUNK);
+    for (size_t y = start; y < end; y++) {
+      values[y] = col.getNumberAt(getRowIndex(y));
+    }
+    partials[p] = computeMoments(values.data() + start, end - start, start);
+  });
+  TABLUZZY_COUNT(rowsScanned, count);
+  // the partial moments are merged in row order
+  Moments total;
+  for (const Moments& partial : partials) total.merge(partial);
+  ColumnStats stats = statsFromMoments(total);
+  stats.median = selectMedian(values);
+  return stats;
+}
+
+void TableView::displayReport() const {
+  // the statistics of every float column are computed in parallel first;
+  // a column selected more than once is only computed by one task, as the
+  // tasks would otherwise fill its cached statistics concurrently
+  vector<const Column*> numerical;
+  vector<size_t> reportOf;
+  for (size_t x = 0; x < columnIndexes.size(); x++) {
+    const Column* col = &getColumn(x);
+    if (col->getValueType() != ValueType::flt) continue;
+    auto found = find(numerical.begin(), numerical.end(), col);
+    reportOf.push_back(found - numerical.begin());
+    if (found == numerical.end()) numerical.push_back(col);
+  }
+  vector<ColumnStats> reports(numerical.size());
+  getThreadPool().parallelFor(numerical.size(), [&](size_t i) {
+    reports[i] = getStats(*numerical[i]);
+  });
+
+  // for every float column in the view
+  for (size_t x = 0; x < reportOf.size(); x++) {
+    // get a reference to the column
+    const Column& col = *numerical[reportOf[x]];
+    // and to its statistics
+    const ColumnStats& stats = reports[reportOf[x]];
+    float min = stats.min;
+    float max = stats.max;
+    float median = stats.median;
+    float mean = stats.mean;
+    float variance = stats.variance;
+    float stdv = stats.stdDeviation;
+    float a = stats.intercept, b = stats.slope;
+
+    // and output them
+    cout << "Column " << colorfmt(fg::cyan) << col.getHeader() << clearfmt
+         << ":" << endl
+         << setw(15) << setfill('-') << "" << endl
+         << bold << "min" << clearfmt << " = " << min << endl
+         << bold << "max" << clearfmt << " = " << max << endl
+         << bold << "med" << clearfmt << " = " << median << endl
+         << bold << "μ" << clearfmt << " = " << mean << endl
+         << bold << "σ²" << clearfmt << " = " << variance << endl
+         << bold << "σ" << clearfmt << " = " << stdv << endl
+         << bold << "regr(x,y)" << clearfmt << " : " << bold << "Y" << clearfmt
+         << " = " << colorfmt(fg::yellow) << a << clearfmt << " + "
+         << colorfmt(fg::yellow) << b << clearfmt << "x" << endl
+         << endl;
+  };
+  cout << endl;
+}
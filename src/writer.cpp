@@ -0,0 +1,57 @@
+#include <cerrno>
+#include <stdexcept>
+
+#include "writer.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <io.h>
+#endif
+
+using namespace std;
+
+BufferedWriter::BufferedWriter(ostream& stream) : out(&stream) {
+  // the buffer is allocated once, with room for a record past its size
+  buffer.reserve(2 * BUFFER_SIZE);
+};
+
+BufferedWriter::BufferedWriter(int descriptor) : fd(descriptor) {
+  buffer.reserve(2 * BUFFER_SIZE);
+};
+
+BufferedWriter::~BufferedWriter() {
+  // a destructor cannot report a failed write, so flush explicitly to see
+  // errors
+  try {
+    flush();
+  } catch (...) {
+  }
+};
+
+void BufferedWriter::flush() {
+  if (buffer.empty()) return;
+  if (out) {
+    out->write(buffer.data(), buffer.size());
+    if (!*out) throw runtime_error("could not write to the output stream");
+  } else {
+    // a descriptor may take fewer bytes than asked for, so we keep writing
+    size_t written = 0;
+    while (written < buffer.size()) {
+#if defined(_WIN32)
+      int result = _write(fd, buffer.data() + written, buffer.size() - written);
+#else
+      ssize_t result =
+          ::write(fd, buffer.data() + written, buffer.size() - written);
+#endif
+      if (result < 0) {
+        // writes interrupted by a signal are retried
+        if (errno == EINTR) continue;
+        throw runtime_error("could not write to file descriptor " +
+                            to_string(fd));
+      }
+      written += result;
+    }
+  }
+  buffer.clear();
+};
@@ -1,4 +1,1122 @@
 #include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <tabluzzy/tabluzzy.hpp>
+
+// builds a small table with one string and one numerical column
+static Table makeTable() {
+  vector<vector<string>> csv = {{"2"},          {"4"},
+                                {"name", "age"}, {"string", "number"},
+                                {"d", "40"},     {"a", "10.5"},
+                                {"c", "30"},     {"b", "20"}};
+  Table table;
+  table.from_csv(csv);
+  return table;
+}
+
 // Demonstrate some basic assertions.
 TEST(HelloTest, BasicAssertions) {
 }
+
+TEST(ColumnTest, NumbersAreStoredNatively) {
+  Table table = makeTable();
+  Column& age = table.getColumnByHeader("age");
+  EXPECT_EQ(age.getNumberOfRows(), 4);
+  EXPECT_DOUBLE_EQ(age.getNumberAt(1), 10.5);
+  EXPECT_EQ(age.getValueAt(1), "10.5");
+  EXPECT_EQ(age.getValueAt(0), "40");
+  EXPECT_FLOAT_EQ(age.getMinimumValue(), 10.5f);
+  EXPECT_FLOAT_EQ(age.getMaximumValue(), 40.0f);
+  EXPECT_FLOAT_EQ(age.getMean(), 25.125f);
+}
+
+TEST(ColumnTest, ValueTypeConversionKeepsValues) {
+  Column col("x", ValueType::str);
+  col.pushValue("1.25");
+  col.pushValue("7");
+  col.setValueType(ValueType::flt);
+  EXPECT_DOUBLE_EQ(col.getNumberAt(0), 1.25);
+  col.setValueType(ValueType::str);
+  EXPECT_EQ(col.getValueAt(1), "7");
+}
+
+TEST(CsvTest, StreamsHeaderBlockAndRows) {
+  stringstream in(
+      "3\n2\nname,score,note\nstring,number,string\n"
+      "alice,1.5,\"says \"\"hi\"\"\"\r\nbob,2,\"multi\nline\"\n");
+  Table table;
+  table.from_csv(in);
+  EXPECT_EQ(table.getNumberOfColumns(), 3);
+  EXPECT_EQ(table.getNumberOfRows(), 2);
+  EXPECT_EQ(table.getValueAt("name", 1), "bob");
+  EXPECT_DOUBLE_EQ(table.getColumnByHeader("score").getNumberAt(0), 1.5);
+  EXPECT_EQ(table.getValueAt("note", 0), "says \"hi\"");
+  EXPECT_EQ(table.getValueAt("note", 1), "multi\nline");
+  // header and datatype records have to name every announced column
+  stringstream shortHeader("3\n1\nname,score\nstring,number,string\na,1,b\n");
+  EXPECT_THROW(Table().from_csv(shortHeader), runtime_error);
+  stringstream shortTypes("3\n1\nname,score,note\nstring,number\na,1,b\n");
+  EXPECT_THROW(Table().from_csv(shortTypes), runtime_error);
+}
+
+TEST(CsvTest, LoadsLargeUnquotedInputInLinearTime) {
+  // every record used to scan the rest of the input for quotes, which made
+  // this load take minutes
+  const int rows = 300000;
+  stringstream in;
+  in << "2\n" << rows << "\nid,name\nnumber,string\n";
+  for (int i = 0; i < rows - 1; i++) in << i << ",n" << i << "\n";
+  in << rows - 1 << ",\"last\nrow\"\n";
+  Table table;
+  table.from_csv(in);
+  ASSERT_EQ(table.getNumberOfRows(), rows);
+  EXPECT_EQ(table.getValueAt("name", 123456), "n123456");
+  EXPECT_EQ(table.getValueAt("name", rows - 1), "last\nrow");
+}
+
+TEST(SortTest, SortsByNumberAndString) {
+  Table table = makeTable();
+  table.sortTableByColumn("age");
+  EXPECT_EQ(table.getValueAt("name", 0), "a");
+  EXPECT_EQ(table.getValueAt("name", 3), "d");
+  table.sortTableByColumn("name", descending);
+  EXPECT_EQ(table.getValueAt("age", 0), "40");
+  EXPECT_EQ(table.getValueAt("age", 3), "10.5");
+}
+
+TEST(SortTest, MultiKeySortIsStable) {
+  vector<vector<string>> csv = {{"3"},
+                                {"5"},
+                                {"group", "value", "id"},
+                                {"string", "number", "number"},
+                                {"b", "1", "0"},
+                                {"a", "2", "1"},
+                                {"b", "1", "2"},
+                                {"a", "1", "3"},
+                                {"b", "0", "4"}};
+  Table table;
+  table.from_csv(csv);
+  table.sortTableByColumns({{"group", ascending}, {"value", descending}});
+  vector<string> ids;
+  for (int y = 0; y < table.getNumberOfRows(); y++) {
+    ids.push_back(table.getValueAt("id", y));
+  }
+  EXPECT_EQ(ids, (vector<string>{"1", "3", "0", "2", "4"}));
+}
+
+TEST(HeaderIndexTest, FollowsColumnChanges) {
+  Table table = makeTable();
+  EXPECT_TRUE(table.columnExists("age"));
+  EXPECT_FALSE(table.columnExists("missing"));
+  table.getColumnByHeader("age").setHeader("years");
+  EXPECT_FALSE(table.columnExists("age"));
+  EXPECT_EQ(table.getValueAt("years", 0), "40");
+  table.deleteColumn("name");
+  EXPECT_EQ(table.getNumberOfColumns(), 1);
+  EXPECT_EQ(&table.getColumnByHeader("years"), &table[0]);
+  table.addColumn("name", ValueType::str);
+  EXPECT_EQ(&table.getColumnByHeader("name"), &table[1]);
+  table.flushTable();
+  EXPECT_FALSE(table.columnExists("years"));
+}
+
+TEST(HeaderIndexTest, RenamesOnlyConcernTheirOwnTable) {
+  Table table = makeTable();
+  Table copy = table;
+  // a copy renames its own columns, before and after its index is rebuilt
+  copy.getColumnByHeader("age").setHeader("years");
+  EXPECT_TRUE(copy.columnExists("years"));
+  EXPECT_TRUE(table.columnExists("age"));
+  EXPECT_FALSE(table.columnExists("years"));
+  copy.getColumnByHeader("name").setHeader("label");
+  EXPECT_EQ(copy.getAllColumnHeaders(), (vector<string>{"label", "years"}));
+  EXPECT_EQ(table.getAllColumnHeaders(), (vector<string>{"name", "age"}));
+  // a table assigned from another looks its columns up by their headers
+  table = copy;
+  EXPECT_EQ(&table.getColumnByHeader("years"), &table[1]);
+  table.getColumnByHeader("years").setHeader("age");
+  EXPECT_TRUE(table.columnExists("age"));
+  EXPECT_TRUE(copy.columnExists("years"));
+}
+
+TEST(AccessorTest, ReferencesAndMovedValues) {
+  Table table = makeTable();
+  const Table& view = table;
+  EXPECT_EQ(&view[1], &table[1]);
+  EXPECT_EQ(view[0].getStringAt(2), "c");
+  const vector<string>& headers = table.getAllColumnHeaders();
+  EXPECT_EQ(headers, (vector<string>{"name", "age"}));
+  table.insertRowAtIndex(vector<string>{"e", "50"}, 1);
+  EXPECT_EQ(table.getNumberOfRows(), 5);
+  EXPECT_EQ(table.getValueAt("name", 1), "e");
+  EXPECT_DOUBLE_EQ(table[1].getNumberAt(1), 50.0);
+}
+
+TEST(StatsTest, FusedStatisticsMatchDefinitions) {
+  Table table = makeTable();
+  Column& age = table.getColumnByHeader("age");
+  const ColumnStats& stats = age.getStats();
+  EXPECT_EQ(stats.count, 4);
+  EXPECT_DOUBLE_EQ(stats.sum, 100.5);
+  EXPECT_DOUBLE_EQ(stats.min, 10.5);
+  EXPECT_DOUBLE_EQ(stats.max, 40);
+  EXPECT_DOUBLE_EQ(stats.mean, 25.125);
+  EXPECT_DOUBLE_EQ(stats.median, 25);
+  // population variance of 40, 10.5, 30, 20
+  double variance = (14.875 * 14.875 + 14.625 * 14.625 + 4.875 * 4.875 +
+                     5.125 * 5.125) / 4;
+  EXPECT_NEAR(stats.variance, variance, 1e-9);
+  // least squares line of the values against the row index 0..3
+  EXPECT_NEAR(stats.slope, -4.05, 1e-9);
+  EXPECT_NEAR(stats.intercept, 25.125 + 4.05 * 1.5, 1e-9);
+}
+
+TEST(StatsTest, CacheIsInvalidatedByMutators) {
+  Table table = makeTable();
+  Column& age = table.getColumnByHeader("age");
+  EXPECT_FLOAT_EQ(age.getMaximumValue(), 40);
+  age.pushValue("90");
+  EXPECT_FLOAT_EQ(age.getMaximumValue(), 90);
+  age.setValueAt(4, "5");
+  EXPECT_FLOAT_EQ(age.getMinimumValue(), 5);
+  EXPECT_FLOAT_EQ(age.getMedian(), 20);
+  age.deleteRow(4);
+  EXPECT_FLOAT_EQ(age.getMedian(), 25);
+  age.insertAtRowIndex(0, "1");
+  EXPECT_FLOAT_EQ(age.getMedian(), 20);
+}
+
+// fills a column with pseudo random numbers that are far from zero, which is
+// where naive summation loses precision
+static Column makeRandomColumn(size_t count) {
+  Column col("values", ValueType::flt);
+  uint64_t state = 42;
+  for (size_t i = 0; i < count; i++) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    col.pushNumber(1e6 + double(state >> 11) / double(1ULL << 53));
+  }
+  return col;
+}
+
+TEST(KernelTest, EverySimdLevelAgreesWithScalarKernels) {
+  SimdLevel best = getSimdLevel();
+  setSimdLevel(noSimd);
+  Column reference = makeRandomColumn(100003);
+  ColumnStats expected = reference.getStats();
+  for (int level = avx2; level <= best; level++) {
+    setSimdLevel(static_cast<SimdLevel>(level));
+    Column col = makeRandomColumn(100003);
+    const ColumnStats& stats = col.getStats();
+    EXPECT_EQ(stats.min, expected.min);
+    EXPECT_EQ(stats.max, expected.max);
+    EXPECT_NEAR(stats.mean, expected.mean, 1e-9);
+    EXPECT_NEAR(stats.variance, expected.variance, 1e-9);
+    EXPECT_NEAR(stats.slope, expected.slope, 1e-12);
+  }
+  setSimdLevel(best);
+}
+
+TEST(KernelTest, MatchesStatsiResults) {
+  Column col = makeRandomColumn(1001);
+  vector<float> values;
+  for (size_t i = 0; i < col.getNumberOfRows(); i++) {
+    values.push_back(col.getNumberAt(i));
+  }
+  EXPECT_FLOAT_EQ(col.getMinimumValue(), getMin(values));
+  EXPECT_FLOAT_EQ(col.getMaximumValue(), getMax(values));
+  EXPECT_FLOAT_EQ(col.getMedian(), calculateMedian(values));
+  EXPECT_FLOAT_EQ(col.getMean(), calculateMean(values));
+}
+
+TEST(ParallelTest, PoolRunsEveryIndexOnce) {
+  setThreadCount(4);
+  vector<atomic<int>> hits(1000);
+  getThreadPool().parallelFor(hits.size(), [&hits](size_t i) {
+    // nested jobs run on the same pool without deadlocking
+    getThreadPool().parallelFor(2, [&hits, i](size_t) { hits[i]++; });
+  });
+  for (atomic<int>& hit : hits) EXPECT_EQ(hit, 2);
+  EXPECT_THROW(getThreadPool().parallelFor(
+                   8, [](size_t i) { if (i == 5) throw runtime_error("x"); }),
+               runtime_error);
+  setThreadCount(0);
+}
+
+TEST(ParallelTest, TableStatisticsMergeAcrossColumnsAndChunks) {
+  setThreadCount(4);
+  Table table;
+  table.addColumn("a", ValueType::flt);
+  table.addColumn("b", ValueType::flt);
+  for (int i = 0; i < 200000; i++) {
+    table[0].pushNumber(i);
+    table[1].pushNumber(-i);
+  }
+  EXPECT_FLOAT_EQ(table.getMinimumValue(), -199999);
+  EXPECT_FLOAT_EQ(table.getMaxiumValue(), 199999);
+  EXPECT_NEAR(table.getMean(), 0, 1e-6);
+  EXPECT_FLOAT_EQ(table.getMedian(), 0);
+  EXPECT_NEAR(get<1>(table[0].getRegression()), 1.0, 1e-6);
+  setThreadCount(0);
+}
+
+TEST(ChunkTest, EditsInTheMiddleMatchAVector) {
+  ChunkedVector<int> chunked;
+  vector<int> reference;
+  for (int i = 0; i < 20000; i++) {
+    chunked.push_back(i);
+    reference.push_back(i);
+  }
+  uint64_t state = 7;
+  for (int i = 0; i < 20000; i++) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    size_t at = (state >> 33) % (reference.size() + 1);
+    if (i % 3 == 0 && at < reference.size()) {
+      chunked.erase(at);
+      reference.erase(reference.begin() + at);
+    } else {
+      chunked.insert(at, -i);
+      reference.insert(reference.begin() + at, -i);
+    }
+  }
+  ASSERT_EQ(chunked.size(), reference.size());
+  for (size_t i = 0; i < reference.size(); i++) {
+    ASSERT_EQ(chunked[i], reference[i]);
+  }
+  size_t seen = 0;
+  chunked.forEachChunk([&](span<const int> chunk) {
+    EXPECT_LE(chunk.size(), 2 * ChunkedVector<int>::CHUNK_SIZE);
+    seen += chunk.size();
+  });
+  EXPECT_EQ(seen, reference.size());
+}
+
+TEST(DeleteTest, MarkedRowsAreSkippedUntilCompaction) {
+  Table table = makeTable();
+  vector<size_t> doomed = {2, 0, 2, 9};
+  EXPECT_EQ(table.deleteRows(doomed), 2);
+  EXPECT_EQ(table.getNumberOfRows(), 2);
+  EXPECT_EQ(table.getNumberOfDeletedRows(), 2);
+  // exports and statistics skip the marked rows without compacting
+  vector<string> csv = table.to_csv();
+  ASSERT_EQ(csv.size(), 6);
+  EXPECT_EQ(csv[1], "2");
+  EXPECT_EQ(csv[4], "a,10.5");
+  EXPECT_FLOAT_EQ(table.getMean(), 15.25);
+  EXPECT_FLOAT_EQ(table.getMedian(), 15.25);
+  EXPECT_EQ(table.getNumberOfDeletedRows(), 2);
+  // indexes count the rows that are left
+  vector<size_t> second = {1};
+  EXPECT_EQ(table.deleteRows(second), 1);
+  EXPECT_EQ(table.getValueAt("name", 0), "a");
+  EXPECT_EQ(table.getNumberOfDeletedRows(), 0);
+  EXPECT_EQ(table.getColumnByHeader("age").getNumberOfRows(), 1);
+}
+
+TEST(DeleteTest, PredicateDeletesInOnePass) {
+  Table table = makeTable();
+  Column& age = table.getColumnByHeader("age");
+  EXPECT_EQ(table.deleteRowsWhere(
+                [&age](size_t row) { return age.getNumberAt(row) > 25; }),
+            2);
+  EXPECT_FLOAT_EQ(table.getMaxiumValue(), 20);
+  table.compact();
+  EXPECT_EQ(table.getNumberOfRows(), 2);
+  EXPECT_EQ(table.getAllValuesInRow(1)[0], "b");
+}
+
+TEST(IndexTest, IndexedLookupsMatchScansAcrossMutations) {
+  Table table = makeTable();
+  table.insertRowAtIndex(vector<string>{"a", "30"}, 4);
+  EXPECT_EQ(table.getRowIndexOfFirstOccurrence("name", string("a")), 1);
+  table.createIndex("name");
+  table.createIndex("age");
+  EXPECT_EQ(table.getRowIndexOfFirstOccurrence("name", string("a")), 1);
+  EXPECT_EQ(table.getRowIndexesOfAllOccurrences("name", "a"),
+            (vector<size_t>{1, 4}));
+  EXPECT_EQ(table.getRowIndexOfFirstOccurrence("age", size_t(30)), 2);
+  EXPECT_EQ(table.getRowIndexesInRange("age", 15, 35),
+            (vector<size_t>{2, 3, 4}));
+  // mutators keep the indexes up to date
+  Column& name = table.getColumnByHeader("name");
+  name.setValueAt(1, "z");
+  table.insertRowAtIndex(vector<string>{"a", "12"}, 5);
+  EXPECT_EQ(name.findAllRows(string_view("a")), (vector<size_t>{4, 5}));
+  EXPECT_EQ(table.getRowIndexOfFirstOccurrence("name", string("z")), 1);
+  table.sortTableByColumn("age");
+  EXPECT_EQ(table.getRowIndexOfFirstOccurrence("age", string("40")), 5);
+  EXPECT_EQ(table.getRowIndexOfFirstOccurrence("name", string("z")), 0);
+  EXPECT_EQ(table.getRowIndexOfFirstOccurrence("name", string("q")), -1);
+}
+
+TEST(IndexTest, IntegerLookupsTruncateValues) {
+  vector<vector<string>> csv = {{"2"},           {"4"},
+                                {"code", "size"}, {"string", "number"},
+                                {"x1", "-0.5"},   {" 7 units", "3.7"},
+                                {"+3", "3"},      {"12", "12.99"}};
+  Table table;
+  table.from_csv(csv);
+  for (bool indexed : {false, true}) {
+    if (indexed) table.createIndex("size");
+    EXPECT_EQ(table.getRowIndexOfFirstOccurrence("size", size_t(3)), 1);
+    EXPECT_EQ(table.getRowIndexOfFirstOccurrence("size", size_t(0)), 0);
+    EXPECT_EQ(table.getRowIndexOfFirstOccurrence("size", size_t(12)), 3);
+    EXPECT_EQ(table.getRowIndexOfFirstOccurrence("size", size_t(13)), -1);
+  }
+  // text is compared by the integer it starts with
+  EXPECT_EQ(table.getRowIndexOfFirstOccurrence("code", size_t(7)), 1);
+  EXPECT_EQ(table.getRowIndexOfFirstOccurrence("code", size_t(3)), 2);
+  EXPECT_EQ(table.getRowIndexOfFirstOccurrence("code", size_t(1)), -1);
+}
+
+TEST(IndexTest, InsertsAndDeletesShiftIndexedRows) {
+  // the indexed columns are checked against twins that are scanned
+  Column numbers("n", ValueType::flt), scannedNumbers("n", ValueType::flt);
+  Column strings("s", ValueType::str), scannedStrings("s", ValueType::str);
+  for (int i = 0; i < 100; i++) {
+    for (Column* col : {&numbers, &scannedNumbers}) col->pushNumber(i % 7);
+    for (Column* col : {&strings, &scannedStrings}) {
+      col->pushValue("v" + to_string(i % 5));
+    }
+  }
+  numbers.createIndex();
+  strings.createIndex();
+  for (int step = 0; step < 50; step++) {
+    size_t at = (step * 37) % numbers.getNumberOfRows();
+    if (step % 3 == 2) {
+      for (Column* col : {&numbers, &scannedNumbers, &strings,
+                          &scannedStrings}) {
+        col->deleteRow(at);
+      }
+    } else {
+      string value = to_string(step % 7);
+      numbers.insertAtRowIndex(at, value);
+      scannedNumbers.insertAtRowIndex(at, value);
+      strings.insertAtRowIndex(at, "v" + value);
+      scannedStrings.insertAtRowIndex(at, "v" + value);
+    }
+    for (int v = 0; v < 7; v++) {
+      ASSERT_EQ(numbers.findAllRows(double(v)),
+                scannedNumbers.findAllRows(double(v)));
+      ASSERT_EQ(strings.findAllRows("v" + to_string(v)),
+                scannedStrings.findAllRows("v" + to_string(v)));
+    }
+    ASSERT_EQ(numbers.findRowsInRange(2, 4),
+              scannedNumbers.findRowsInRange(2, 4));
+  }
+
+  // runs of edits between lookups are applied together, long runs rebuild
+  // the index
+  unsigned seed = 7;
+  auto next = [&seed](size_t bound) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % bound;
+  };
+  for (size_t run : {1, 2, 5, 20, 100, 400}) {
+    for (size_t edit = 0; edit < run; edit++) {
+      size_t at = next(numbers.getNumberOfRows());
+      string value = to_string(next(7));
+      size_t kind = next(5);
+      for (Column* col : {&numbers, &scannedNumbers, &strings,
+                          &scannedStrings}) {
+        string cell = (col->getValueType() == ValueType::flt) ? value
+                                                              : "v" + value;
+        if (kind == 0) col->deleteRow(at);
+        if (kind == 1) col->insertAtRowIndex(at, cell);
+        if (kind == 2) col->setValueAt(at, cell);
+        if (kind == 3) col->pushValue(cell);
+        if (kind == 4) col->swapRows(at, col->getNumberOfRows() - 1 - at);
+      }
+    }
+    for (int v = 0; v < 7; v++) {
+      ASSERT_EQ(numbers.findAllRows(double(v)),
+                scannedNumbers.findAllRows(double(v)));
+      ASSERT_EQ(strings.findAllRows("v" + to_string(v)),
+                scannedStrings.findAllRows("v" + to_string(v)));
+    }
+    ASSERT_EQ(numbers.findRowsInRange(1, 3),
+              scannedNumbers.findRowsInRange(1, 3));
+  }
+}
+
+TEST(EncodingTest, RepeatedStringsAreDictionaryEncoded) {
+  const char* statuses[] = {"open", "closed", "pending"};
+  stringstream in;
+  in << "2\n10000\nstatus,id\nstring,string\n";
+  for (int i = 0; i < 10000; i++) in << statuses[i % 3] << ",id" << i << "\n";
+  Table table;
+  table.from_csv(in);
+  Column& status = table.getColumnByHeader("status");
+  EXPECT_EQ(status.getStringEncoding(), dictionaryEncoding);
+  EXPECT_EQ(status.getDictionarySize(), 3);
+  EXPECT_EQ(table.getColumnByHeader("id").getStringEncoding(), plainEncoding);
+  EXPECT_EQ(table.getValueAt("status", 4), "closed");
+  EXPECT_EQ(table.getRowIndexOfFirstOccurrence("status", string("pending")),
+            2);
+  status.setValueAt(0, "reopened");
+  EXPECT_EQ(status[0], "reopened");
+  table.sortTableByColumns({{"status"}, {"id", descending}});
+  EXPECT_EQ(table.getValueAt("status", 0), "closed");
+  EXPECT_EQ(table.getValueAt("status", 9999), "reopened");
+  EXPECT_EQ(table.getValueAt("id", 0), "id9997");
+  EXPECT_EQ(table.getAllValuesInRow(1)[1], "id9994");
+  status.setStringEncoding(plainEncoding);
+  EXPECT_EQ(status.getDictionarySize(), 0);
+  EXPECT_EQ(table.getValueAt("status", 9999), "reopened");
+}
+
+TEST(ArenaTest, StringsStayValidAcrossBlocks) {
+  StringArena arena;
+  vector<StrRef> refs;
+  string big(StringArena::BLOCK_SIZE + 10, 'x');
+  for (int i = 0; i < 100000; i++) refs.push_back(arena.store(to_string(i)));
+  StrRef bigRef = arena.store(big);
+  refs.push_back(arena.store(""));
+  EXPECT_EQ(arena.view(refs[0]), "0");
+  EXPECT_EQ(arena.view(refs[99999]), "99999");
+  EXPECT_EQ(arena.view(bigRef), big);
+  EXPECT_EQ(arena.view(refs.back()), "");
+
+  Column name("name", ValueType::str);
+  name.pushValue("a");
+  name.pushValue("b");
+  name.setValueAt(0, "c");
+  string_view view = name.getStringAt(0);
+  name.pushString(view);
+  EXPECT_EQ(name.getStringAt(2), "c");
+  name.applyPermutation({1, 2, 0});
+  EXPECT_EQ(name.getAllValues(), (vector<string>{"b", "c", "c"}));
+}
+
+TEST(ArenaTest, OverwrittenStringsAreReclaimed) {
+  Column notes("notes", ValueType::str);
+  for (int i = 0; i < 100; i++) notes.pushValue("note" + to_string(i));
+  notes.createIndex();
+  // every overwrite stores 1000 new bytes, 10 MiB in total
+  for (int i = 0; i < 10000; i++) {
+    notes.setValueAt(i % 100, string(999, 'a' + i % 26) + to_string(i % 10));
+  }
+  notes.deleteRow(0);
+  EXPECT_LE(notes.getStringBytes(), 3 * StringArena::BLOCK_SIZE);
+  EXPECT_EQ(notes.getNumberOfRows(), 99);
+  EXPECT_EQ(notes.getStringAt(98), string(999, 'a' + 9999 % 26) + "9");
+  EXPECT_EQ(notes.findFirstRow(notes.getStringAt(50)), 50);
+}
+
+TEST(SnapshotTest, RoundTripsEveryColumnKind) {
+  stringstream in;
+  in << "3\n6000\nstatus,id,score\nstring,string,number\n";
+  for (int i = 0; i < 6000; i++) {
+    in << (i % 2 ? "on" : "off") << ",id" << i << "," << i * 0.5 << "\n";
+  }
+  Table table;
+  table.from_csv(in);
+  vector<size_t> doomed = {0};
+  table.deleteRows(doomed);
+  string path = testing::TempDir() + "tabluzzy_snapshot.bin";
+  table.to_snapshot(path);
+
+  Table loaded;
+  loaded.from_snapshot(path);
+  ASSERT_EQ(loaded.getNumberOfRows(), 5999);
+  ASSERT_EQ(loaded.getNumberOfColumns(), 3);
+  EXPECT_EQ(loaded.getColumnByHeader("status").getStringEncoding(),
+            dictionaryEncoding);
+  EXPECT_EQ(loaded.getValueAt("status", 0), "on");
+  EXPECT_EQ(loaded.getValueAt("id", 5998), "id5999");
+  EXPECT_DOUBLE_EQ(loaded.getColumnByHeader("score").getNumberAt(1), 1);
+  EXPECT_FLOAT_EQ(loaded.getMaxiumValue(), 2999.5);
+  // borrowed rows are copied once they are modified
+  loaded.getColumnByHeader("id").setValueAt(3, "changed");
+  loaded.insertRowAtIndex(vector<string>{"new", "x", "-1"}, 0);
+  EXPECT_EQ(loaded.getValueAt("id", 4), "changed");
+  EXPECT_EQ(loaded.getValueAt("status", 0), "new");
+  loaded.sortTableByColumn("score");
+  EXPECT_EQ(loaded.getValueAt("id", 0), "x");
+  remove(path.c_str());
+
+  stringstream bad("not a snapshot");
+  ofstream(path) << bad.rdbuf();
+  EXPECT_THROW(loaded.from_snapshot(path), runtime_error);
+  remove(path.c_str());
+}
+
+TEST(WriterTest, StreamedCsvMatchesLinesAndRoundTrips) {
+  stringstream in;
+  in << "2\n3\nname,value\nstring,number\n";
+  in << "a,10\n\"b, \"\"quoted\"\"\",20\nc,30.5\n";
+  Table table;
+  table.from_csv(in);
+  vector<size_t> doomed = {0};
+  table.deleteRows(doomed);
+
+  vector<string> lines = table.to_csv();
+  ASSERT_EQ(lines.size(), 6);
+  EXPECT_EQ(lines[1], "2");
+  EXPECT_EQ(lines[4], "\"b, \"\"quoted\"\"\",20");
+  EXPECT_EQ(lines[5], "c,30.5");
+
+  stringstream out;
+  table.to_csv(out);
+  string joined;
+  for (const string& line : lines) joined += line + "\n";
+  EXPECT_EQ(out.str(), joined);
+
+  Table loaded;
+  loaded.from_csv(out);
+  ASSERT_EQ(loaded.getNumberOfRows(), 2);
+  EXPECT_EQ(loaded.getValueAt("name", 0), "b, \"quoted\"");
+
+  stringstream html;
+  table.to_html(html);
+  string tags;
+  for (const string& tag : table.to_html()) tags += tag + "\n";
+  EXPECT_EQ(html.str(), tags);
+}
+
+TEST(CsvTest, ParallelParseMatchesSerialParse) {
+  // enough rows for the file to be split into several parts, with quoted
+  // fields holding newlines, commas and quotes across the part boundaries
+  const int rows = 150000;
+  string path = testing::TempDir() + "tabluzzy_parallel.csv";
+  {
+    ofstream out(path, ios::binary);
+    out << "4\n" << rows << "\nkind,id,note,value\n";
+    out << "string,string,string,number\n";
+    for (int i = 0; i < rows; i++) {
+      out << (i % 3 ? "left" : "right") << ",id" << i << ",";
+      if (i % 7 == 0) {
+        out << "\"line\nbreak, \"\"" << i << "\"\"\"";
+      } else {
+        out << "plain";
+      }
+      out << "," << i * 0.25 << "\n";
+    }
+    // records after the announced rows are ignored
+    out << "\n\n";
+  }
+  setThreadCount(4);
+  Table serial, parallel;
+  serial.from_csv(path);
+  parallel.from_csv_parallel(path);
+  setThreadCount(0);
+
+  ASSERT_EQ(parallel.getNumberOfRows(), rows);
+  EXPECT_EQ(parallel.getColumnByHeader("kind").getStringEncoding(),
+            dictionaryEncoding);
+  EXPECT_EQ(parallel.getColumnByHeader("id").getStringEncoding(),
+            plainEncoding);
+  for (int y = 0; y < rows; y += 997) {
+    for (const string& header : {"kind", "id", "note", "value"}) {
+      ASSERT_EQ(parallel.getValueAt(header, y), serial.getValueAt(header, y));
+    }
+  }
+  EXPECT_EQ(parallel.getValueAt("note", 7), "line\nbreak, \"7\"");
+  EXPECT_EQ(parallel.getValueAt("id", rows - 1), "id" + to_string(rows - 1));
+  EXPECT_DOUBLE_EQ(parallel.getColumnByHeader("value").getMean(),
+                   serial.getColumnByHeader("value").getMean());
+
+  // a broken record within the announced rows is reported at its row
+  {
+    ofstream out(path, ios::binary);
+    out << "2\n3\na,b\nstring,string\nx,y\nbroken\nz,w\n";
+  }
+  Table broken;
+  EXPECT_THROW(broken.from_csv_parallel(path), runtime_error);
+
+  // parts without any quotes are split and tokenized in linear time
+  const int unquotedRows = 400000;
+  {
+    ofstream out(path, ios::binary);
+    out << "2\n" << unquotedRows << "\nid,name\nnumber,string\n";
+    for (int i = 0; i < unquotedRows; i++) out << i << ",n" << i << "\n";
+  }
+  setThreadCount(4);
+  Table unquoted;
+  unquoted.from_csv_parallel(path);
+  setThreadCount(0);
+  ASSERT_EQ(unquoted.getNumberOfRows(), unquotedRows);
+  EXPECT_EQ(unquoted.getValueAt("name", unquotedRows - 1),
+            "n" + to_string(unquotedRows - 1));
+  EXPECT_DOUBLE_EQ(unquoted.getColumnByHeader("id").getMean(),
+                   (unquotedRows - 1) / 2.0);
+  remove(path.c_str());
+}
+
+TEST(NumbersTest, ParsesAndFormatsWithoutThrowing) {
+  double value;
+  EXPECT_EQ(parseNumber(" +2.5e3 ", value), parsedNumber);
+  EXPECT_DOUBLE_EQ(value, 2500);
+  EXPECT_EQ(parseNumber("-0.125", value), parsedNumber);
+  EXPECT_DOUBLE_EQ(value, -0.125);
+  EXPECT_EQ(parseNumber("", value), nullNumber);
+  EXPECT_TRUE(isnan(value));
+  EXPECT_EQ(parseNumber("nan", value), nullNumber);
+  EXPECT_EQ(parseNumber("12abc", value), invalidNumber);
+  EXPECT_TRUE(isnan(value));
+  EXPECT_EQ(parseNumber("+-1", value), invalidNumber);
+  EXPECT_EQ(formatNumber(0.1), "0.1");
+  EXPECT_EQ(formatNumber(1e21), "1e+21");
+  EXPECT_EQ(formatNumber(-3), "-3");
+  EXPECT_EQ(formatNumber(numeric_limits<double>::quiet_NaN()), "");
+  size_t count;
+  EXPECT_TRUE(parseCount("42", count));
+  EXPECT_EQ(count, 42);
+  EXPECT_FALSE(parseCount("4x", count));
+
+  // cells that are not numbers are loaded as missing numbers and reported
+  stringstream in;
+  in << "2\n5\nname,value\nstring,number\n";
+  in << "a,1\nb,\nc,oops\nd,3\ne,nan\n";
+  Table table;
+  table.from_csv(in);
+  const ParseReport& report = table.getParseReport();
+  EXPECT_EQ(report.nullCells, 2);
+  EXPECT_EQ(report.invalidCells, 1);
+  EXPECT_EQ(report.firstInvalidRow, 2);
+  EXPECT_EQ(report.firstInvalidColumn, 1);
+  // and the statistics leave them out
+  const Column& values = table.getColumnByHeader("value");
+  EXPECT_DOUBLE_EQ(values.getMean(), 2);
+  EXPECT_DOUBLE_EQ(values.getMedian(), 2);
+  EXPECT_EQ(table.getValueAt("value", 1), "");
+  EXPECT_TRUE(table.canBeInsertedIntoTable({"f", ""}));
+  EXPECT_FALSE(table.canBeInsertedIntoTable({"f", "x1"}));
+}
+
+TEST(MetricsTest, CountsOperationsWhenEnabled) {
+  resetMetrics();
+  Table table = makeTable();
+  table.sortTableByColumn("age");
+  table.getColumnByHeader("age").getMean();
+  stringstream out;
+  table.to_csv(out);
+  Metrics metrics = getMetrics();
+#ifdef TABLUZZY_METRICS
+  EXPECT_TRUE(metrics.enabled);
+  EXPECT_EQ(metrics.getTimer(sortTimer).calls, 1);
+  EXPECT_GE(metrics.getTimer(csvExportTimer).calls, 1);
+  EXPECT_GT(metrics.getCounter(rowsScanned), 0);
+  EXPECT_GT(metrics.getCounter(numberConversions), 0);
+  EXPECT_GT(metrics.getCounter(bytesAllocated), 0);
+  resetMetrics();
+  EXPECT_EQ(getMetrics().getTimer(sortTimer).calls, 0);
+  // statistics are timed once per call, however many steps they take
+  table.getColumnByHeader("age").getStats({false, true, false, false});
+  EXPECT_EQ(getMetrics().getTimer(statisticsTimer).calls, 1);
+#else
+  EXPECT_FALSE(metrics.enabled);
+  EXPECT_EQ(metrics.getCounter(rowsScanned), 0);
+#endif
+  string json = metrics.to_json();
+  EXPECT_NE(json.find("\"sort\":{\"calls\":"), string::npos);
+  EXPECT_NE(json.find("\"columnCopies\":"), string::npos);
+}
+
+TEST(FilterTest, PredicatesMatchRowByRowChecks) {
+  stringstream in;
+  const int rows = 10000;
+  in << "3\n" << rows << "\ncity,id,score\nstring,string,number\n";
+  const char* cities[] = {"berlin", "bern", "paris", "rome"};
+  for (int i = 0; i < rows; i++) {
+    in << cities[i % 4] << ",id" << i << ",";
+    // every 10th score is missing
+    if (i % 10 != 0) in << i % 100;
+    in << "\n";
+  }
+  Table table;
+  table.from_csv(in);
+  ASSERT_EQ(table.getColumnByHeader("city").getStringEncoding(),
+            dictionaryEncoding);
+  vector<size_t> doomed = {1};
+  table.deleteRows(doomed);
+
+  // checks a predicate against a test of every row
+  auto check = [&](const Predicate& predicate,
+                   const function<bool(const string&, const string&,
+                                       double)>& expected) {
+    vector<size_t> found = table.filterRows(predicate);
+    vector<size_t> wanted;
+    const Column& city = table.getColumnByHeader("city");
+    const Column& id = table.getColumnByHeader("id");
+    const Column& score = table.getColumnByHeader("score");
+    for (size_t y = 0; y < table.getNumberOfRows(); y++) {
+      if (expected(string(city.getStringAt(y)), string(id.getStringAt(y)),
+                   score.getNumberAt(y))) {
+        wanted.push_back(y);
+      }
+    }
+    EXPECT_EQ(found, wanted);
+  };
+  check(Predicate::compare("score", greaterThan, 90),
+        [](auto&, auto&, double s) { return s > 90; });
+  check(Predicate::compare("score", notEqualTo, 5),
+        [](auto&, auto&, double s) { return !isnan(s) && s != 5; });
+  check(Predicate::between("score", 10, 20),
+        [](auto&, auto&, double s) { return s >= 10 && s <= 20; });
+  check(Predicate::compare("city", equalTo, string("paris")),
+        [](auto& c, auto&, double) { return c == "paris"; });
+  check(Predicate::startsWith("city", "ber") &&
+            !Predicate::compare("city", equalTo, string("bern")),
+        [](auto& c, auto&, double) { return c == "berlin"; });
+  check(Predicate::startsWith("id", "id99") ||
+            Predicate::compare("id", lessThan, string("id1")),
+        [](auto&, auto& i, double) {
+          return i.rfind("id99", 0) == 0 || i < "id1";
+        });
+
+  Table filtered = table.filter(Predicate::compare("city", equalTo,
+                                                   string("rome")) &&
+                                Predicate::compare("score", lessThan, 20));
+  ASSERT_EQ(filtered.getNumberOfRows(), 500);
+  EXPECT_EQ(filtered.getValueAt("id", 0), "id3");
+  EXPECT_EQ(filtered.getValueAt("city", 499), "rome");
+  EXPECT_FLOAT_EQ(filtered.getColumnByHeader("score").getMean(), 11);
+  EXPECT_THROW(table.filterRows(Predicate::compare("city", equalTo, 1.0)),
+               runtime_error);
+}
+
+TEST(GroupByTest, GroupStatisticsMatchFilteredColumns) {
+  setThreadCount(4);
+  stringstream in;
+  const int rows = 150000;
+  in << "3\n" << rows << "\ncity,band,score\nstring,string,number\n";
+  const char* cities[] = {"berlin", "bern", "paris", "rome"};
+  for (int i = 0; i < rows; i++) {
+    in << cities[i % 4] << ",b" << i % 3 << ",";
+    // every 7th score is missing
+    if (i % 7 != 0) in << (i * 37) % 1000 / 10.0;
+    in << "\n";
+  }
+  Table table;
+  table.from_csv(in);
+  table.getColumnByHeader("band").setStringEncoding(plainEncoding);
+
+  Table grouped = table.groupBy({"city", "band"});
+  setThreadCount(0);
+  ASSERT_EQ(grouped.getNumberOfRows(), 12);
+  ASSERT_EQ(grouped.getNumberOfColumns(), 8);
+  // the groups come in the order they first appear
+  EXPECT_EQ(grouped.getValueAt("city", 0), "berlin");
+  EXPECT_EQ(grouped.getValueAt("band", 1), "b1");
+  for (size_t g = 0; g < grouped.getNumberOfRows(); g++) {
+    string city = grouped.getValueAt("city", g);
+    string band = grouped.getValueAt("band", g);
+    Table rowsOfGroup =
+        table.filter(Predicate::compare("city", equalTo, city) &&
+                     Predicate::compare("band", equalTo, band));
+    ColumnStats expected =
+        rowsOfGroup.getColumnByHeader("score").getStats();
+    auto at = [&](const string& header) {
+      return grouped.getColumnByHeader(header).getNumberAt(g);
+    };
+    EXPECT_EQ(at("count"), rowsOfGroup.getNumberOfRows());
+    EXPECT_NEAR(at("score_sum"), expected.sum, 1e-6 * fabs(expected.sum));
+    EXPECT_EQ(at("score_min"), expected.min);
+    EXPECT_EQ(at("score_max"), expected.max);
+    EXPECT_NEAR(at("score_mean"), expected.mean, 1e-9);
+    EXPECT_NEAR(at("score_variance"), expected.variance, 1e-6);
+  }
+  EXPECT_THROW(table.groupBy({"city"}, {"band"}), runtime_error);
+
+  // generated headers that are already taken are numbered
+  stringstream taken;
+  taken << "3\n3\ncount,x_sum,x\nstring,string,number\n"
+        << "a,p,1\na,p,2\nb,q,4\n";
+  Table counted;
+  counted.from_csv(taken);
+  Table byCount = counted.groupBy({"count", "x_sum"});
+  EXPECT_EQ(byCount.getAllColumnHeaders(),
+            (vector<string>{"count", "x_sum", "count2", "x_sum2", "x_min",
+                            "x_max", "x_mean", "x_variance"}));
+  EXPECT_EQ(byCount.getValueAt("count", 0), "a");
+  EXPECT_DOUBLE_EQ(byCount.getColumnByHeader("count2").getNumberAt(0), 2);
+  EXPECT_DOUBLE_EQ(byCount.getColumnByHeader("x_sum2").getNumberAt(1), 4);
+}
+
+TEST(JoinTest, InnerAndLeftJoinsMatchEveryKey) {
+  stringstream left, right;
+  left << "2\n4\nkey,name\nnumber,string\n1,a\n2,b\n2,c\n,d\n";
+  right << "2\n4\nkey,name\nnumber,string\n2,x\n3,y\n2,z\n,w\n";
+  Table small, other;
+  small.from_csv(left);
+  other.from_csv(right);
+  Table inner = small.join(other, "key");
+  ASSERT_EQ(inner.getNumberOfRows(), 4);
+  ASSERT_EQ(inner.getNumberOfColumns(), 3);
+  EXPECT_EQ(inner.getValueAt("name", 0), "b");
+  EXPECT_EQ(inner.getValueAt("name_right", 0), "x");
+  EXPECT_EQ(inner.getValueAt("name_right", 1), "z");
+  EXPECT_EQ(inner.getValueAt("name", 3), "c");
+  // missing numbers never match, so d is kept only by the left join
+  Table outer = small.join(other, "key", leftJoin);
+  ASSERT_EQ(outer.getNumberOfRows(), 6);
+  EXPECT_EQ(outer.getValueAt("name", 0), "a");
+  EXPECT_EQ(outer.getValueAt("name_right", 0), "");
+  EXPECT_EQ(outer.getValueAt("name", 5), "d");
+
+  // suffixed headers that are taken as well are numbered
+  stringstream taken;
+  taken << "3\n1\nkey,name,name_right\nnumber,string,string\n2,x,y\n";
+  Table both;
+  both.from_csv(taken);
+  Table twice = both.join(both, "key");
+  EXPECT_EQ(twice.getAllColumnHeaders(),
+            (vector<string>{"key", "name", "name_right", "name_right2",
+                            "name_right_right"}));
+  EXPECT_EQ(twice.getValueAt("name_right2", 0), "x");
+  EXPECT_EQ(twice.getValueAt("name_right_right", 0), "y");
+
+  // big tables are partitioned and probed on every thread
+  setThreadCount(4);
+  const int customers = 70000, orders = 140000;
+  stringstream customerCsv, orderCsv;
+  customerCsv << "2\n" << customers << "\nid,score\nstring,number\n";
+  for (int k = 0; k < customers; k++) {
+    customerCsv << "c" << k << "," << k % 100 << "\n";
+  }
+  orderCsv << "2\n" << orders << "\norder,customer\nnumber,string\n";
+  vector<vector<int>> ordersOf(customers);
+  size_t matched = 0;
+  for (int i = 0; i < orders; i++) {
+    int k = i * 7 % 80000;
+    orderCsv << i << ",c" << k << "\n";
+    if (k < customers) {
+      ordersOf[k].push_back(i);
+      matched++;
+    }
+  }
+  Table customerTable, orderTable;
+  customerTable.from_csv(customerCsv);
+  orderTable.from_csv(orderCsv);
+
+  Table byCustomer = customerTable.join(orderTable, "id", "customer");
+  ASSERT_EQ(byCustomer.getNumberOfRows(), matched);
+  const Column& order = byCustomer.getColumnByHeader("order");
+  const Column& score = byCustomer.getColumnByHeader("score");
+  size_t row = 0;
+  for (int k = 0; k < customers; k++) {
+    for (int i : ordersOf[k]) {
+      ASSERT_EQ(order.getNumberAt(row), i);
+      ASSERT_EQ(score.getNumberAt(row), k % 100);
+      row++;
+    }
+  }
+
+  Table byOrder = orderTable.join(customerTable, "customer", "id", leftJoin);
+  setThreadCount(0);
+  ASSERT_EQ(byOrder.getNumberOfRows(), orders);
+  const Column& orderScore = byOrder.getColumnByHeader("score");
+  for (int i = 0; i < orders; i++) {
+    int k = i * 7 % 80000;
+    if (k < customers) {
+      ASSERT_EQ(orderScore.getNumberAt(i), k % 100);
+    } else {
+      ASSERT_TRUE(isnan(orderScore.getNumberAt(i)));
+    }
+  }
+  EXPECT_THROW(small.join(other, "key", "name"), runtime_error);
+}
+
+TEST(ViewTest, ComposedViewsExportWithoutChangingTheTable) {
+  stringstream in;
+  in << "3\n6\nname,age,score\nstring,number,number\n"
+     << "ann,31,7\nbob,25,9\ncid,40,3\ndan,35,9\neve,28,5\nfay,52,1\n";
+  Table table;
+  table.from_csv(in);
+  // rows pending deletion are never viewed
+  vector<size_t> doomed = {4};
+  table.deleteRows(doomed);
+  vector<string> before = table.to_csv();
+
+  TableView view = TableView(table)
+                       .where(Predicate::compare("age", greaterThan, 26))
+                       .sortedBy({{"score", descending}, {"name", ascending}})
+                       .select({"name", "score"});
+  ASSERT_EQ(view.getNumberOfRows(), 4);
+  EXPECT_EQ(view.getValueAt("name", 0), "dan");
+  vector<string> csv = view.slice(1, 2).to_csv();
+  vector<string> expected = {"2", "2", "name,score", "string,number",
+                             "ann,7", "cid,3"};
+  EXPECT_EQ(csv, expected);
+  EXPECT_EQ(view.slice(3, 10).getNumberOfRows(), 1);
+  EXPECT_EQ(view.withRows({3, 0}).getValueAt("name", 0), "fay");
+  EXPECT_THROW(view.withRows({4}), out_of_range);
+  stringstream html;
+  view.to_html(html);
+  EXPECT_NE(html.str().find("<td>dan</td>"), string::npos);
+  EXPECT_EQ(html.str().find("<td>bob</td>"), string::npos);
+
+  // the statistics of a view are those of a table holding its rows
+  ColumnStats stats = view.getStats("score");
+  EXPECT_EQ(stats.count, 4);
+  EXPECT_DOUBLE_EQ(stats.mean, 5);
+  EXPECT_DOUBLE_EQ(stats.median, 5);
+  EXPECT_DOUBLE_EQ(stats.max, 9);
+  ColumnStats whole = TableView(table).getStats("age");
+  EXPECT_DOUBLE_EQ(whole.mean, (31 + 25 + 40 + 35 + 52) / 5.0);
+  EXPECT_THROW(view.getStats("name"), runtime_error);
+  EXPECT_EQ(table.to_csv(), before);
+  EXPECT_EQ(table.getNumberOfDeletedRows(), 1);
+}
+
+TEST(ViewTest, ReportsAColumnSelectedTwice) {
+  stringstream in;
+  in << "2\n20000\nid,score\nnumber,number\n";
+  for (int i = 0; i < 20000; i++) in << i << "," << i % 10 << "\n";
+  Table table;
+  table.from_csv(in);
+  TableView view = TableView(table).select({"score", "id", "score"});
+
+  // the report holds one section per selected column
+  setThreadCount(4);
+  stringstream out;
+  streambuf* previous = cout.rdbuf(out.rdbuf());
+  view.displayReport();
+  cout.rdbuf(previous);
+  setThreadCount(0);
+  string report = out.str();
+  size_t sections = 0;
+  for (size_t at = report.find("score"); at != string::npos;
+       at = report.find("score", at + 1)) {
+    sections++;
+  }
+  EXPECT_EQ(sections, 2);
+  EXPECT_NE(report.find("id"), string::npos);
+  EXPECT_DOUBLE_EQ(table.getColumnByHeader("score").getMean(), 4.5);
+}
+
+TEST(CopyTest, CopiesShareStorageUntilTheyChangeIt) {
+  stringstream in;
+  in << "3\n10000\nid,city,note\nnumber,string,string\n";
+  for (int i = 0; i < 10000; i++) {
+    in << i << "," << (i % 3 ? "rome" : "oslo") << ",n" << i << "\n";
+  }
+  Table table;
+  table.from_csv(in);
+  table.getColumnByHeader("city").createIndex();
+  vector<string> before = table.to_csv();
+
+  // a copy points at the same numbers as the table
+  auto blocksOf = [](Table& t) {
+    vector<const double*> blocks;
+    t.getColumnByHeader("id").forEachNumberBlock(
+        [&](span<const double> block) { blocks.push_back(block.data()); });
+    return blocks;
+  };
+  Table copy = table;
+  vector<const double*> shared = blocksOf(table);
+  ASSERT_EQ(shared.size(), 3);
+  EXPECT_EQ(blocksOf(copy), shared);
+
+  // and only copies the chunk it changes
+  copy.getColumnByHeader("id").setNumberAt(5000, -1);
+  vector<const double*> edited = blocksOf(copy);
+  EXPECT_EQ(edited[0], shared[0]);
+  EXPECT_NE(edited[1], shared[1]);
+  EXPECT_EQ(edited[2], shared[2]);
+  EXPECT_EQ(blocksOf(table), shared);
+
+  // new strings and new dictionary values stay in the copy
+  copy.getColumnByHeader("note").setValueAt(1, "changed");
+  copy.getColumnByHeader("city").setValueAt(2, "lima");
+  copy.insertRowAtIndex({"-2", "oslo", "first"}, 0);
+  EXPECT_EQ(copy.getValueAt("city", 3), "lima");
+  EXPECT_EQ(copy.getColumnByHeader("city").findFirstRow("lima"), 3);
+  EXPECT_EQ(copy.getValueAt("note", 0), "first");
+  EXPECT_EQ(table.to_csv(), before);
+  EXPECT_EQ(table.getColumnByHeader("city").getDictionarySize(), 2);
+  EXPECT_EQ(table.getColumnByHeader("city").findFirstRow("lima"), -1);
+
+  // copies taken on other threads change their own storage only
+  vector<thread> threads;
+  vector<string> firstNotes(4);
+  for (size_t t = 0; t < firstNotes.size(); t++) {
+    threads.emplace_back([&, t] {
+      Table own = table;
+      own.getColumnByHeader("note").setValueAt(0, "thread" + to_string(t));
+      // the shared dictionary is ranked by one thread while others compare
+      const Column& city = own.getColumnByHeader("city");
+      for (int i = 0; i < 1000; i++) EXPECT_LT(city.compareRows(0, 1), 0);
+      own.sortTableByColumn("city", ascending);
+      firstNotes[t] = own.getValueAt("note", 0);
+    });
+  }
+  for (thread& th : threads) th.join();
+  EXPECT_EQ(firstNotes[3], "thread3");
+  EXPECT_EQ(table.to_csv(), before);
+}
+
+TEST(CopyTest, SortingACopyOnlyAllocatesTheSortedChunks) {
+  stringstream in;
+  in << "1\n10000\nid\nnumber\n";
+  for (int i = 0; i < 10000; i++) in << i << "\n";
+  Table table;
+  table.from_csv(in);
+  auto blocksOf = [](Table& t) {
+    vector<const double*> blocks;
+    t.getColumnByHeader("id").forEachNumberBlock(
+        [&](span<const double> block) { blocks.push_back(block.data()); });
+    return blocks;
+  };
+  vector<const double*> shared = blocksOf(table);
+
+  Table copy = table;
+  resetMetrics();
+  copy.sortTableByColumn("id", descending);
+  EXPECT_EQ(copy.getValueAt("id", 0), "9999");
+#ifdef TABLUZZY_METRICS
+  // the shared chunks are read as they are, only the sorted ones are new
+  EXPECT_EQ(getMetrics().getCounter(bytesAllocated),
+            shared.size() * ChunkedVector<double>::CHUNK_SIZE *
+                sizeof(double));
+#endif
+  // the table keeps its chunks, and so does a copy until it is sorted into
+  Table other = table;
+  EXPECT_EQ(blocksOf(table), shared);
+  EXPECT_EQ(blocksOf(other), shared);
+  other = copy;
+  EXPECT_EQ(blocksOf(other), blocksOf(copy));
+  EXPECT_EQ(blocksOf(table), shared);
+  EXPECT_EQ(table.getValueAt("id", 0), "0");
+}
+
+#ifdef TABLUZZY_ARROW
+TEST(ArrowTest, RoundTripsFileAndStream) {
+  Table table = makeTable();
+  table.getColumnByHeader("name").setStringEncoding(dictionaryEncoding);
+  for (bool stream : {false, true}) {
+    string path = testing::TempDir() + "tabluzzy_table.arrow";
+    table.to_arrow(path, stream);
+    Table loaded;
+    loaded.from_arrow(path);
+    ASSERT_EQ(loaded.getNumberOfRows(), 4);
+    EXPECT_EQ(loaded.getColumnByHeader("name").getStringEncoding(),
+              dictionaryEncoding);
+    EXPECT_EQ(loaded.getValueAt("name", 2), "c");
+    EXPECT_DOUBLE_EQ(loaded.getColumnByHeader("age").getNumberAt(1), 10.5);
+    remove(path.c_str());
+  }
+}
+
+TEST(ArrowTest, ExportedTablesOutliveChangesAndTheirTable) {
+  shared_ptr<arrow::Table> exported;
+  {
+    Table table = makeTable();
+    table.getColumnByHeader("name").setStringEncoding(dictionaryEncoding);
+    exported = table.to_arrow_table();
+    // the table copies the chunks it shares before changing them
+    table.getColumnByHeader("age").setNumberAt(1, 99);
+    table.getColumnByHeader("name").setValueAt(2, "d");
+    EXPECT_EQ(table.getValueAt("name", 2), "d");
+  }
+  Table loaded;
+  loaded.from_arrow_table(exported);
+  ASSERT_EQ(loaded.getNumberOfRows(), 4);
+  EXPECT_DOUBLE_EQ(loaded.getColumnByHeader("age").getNumberAt(1), 10.5);
+  EXPECT_EQ(loaded.getValueAt("name", 2), "c");
+}
+#endif